@@ -0,0 +1,93 @@
+/*  
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks 
+ *
+ *  In this post we are going to implement reader-writer lock
+ *  that spins before it sleeps (see adaptive_lock.h). The critical
+ *  section is a single increment, so a thread finding the lock busy
+ *  first spins for a short while with exponential backoff and is usually
+ *  let in before it would have finished going to sleep, it only parks
+ *  when the spin window runs out. The lock counts its acquisitions,
+ *  contention, spin time and park time, they are printed at the end.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name>
+ */
+
+# include <stdio.h>
+# include <pthread.h>
+# include "adaptive_lock.h"
+
+// adaptive reader-writer lock with its statistics
+adaptive_rwlock_t rwlock;
+// shared variable between reader and writer threads
+int shared_data;
+
+void *writer(void *arg) {
+	// take the lock once no reader or writer is inside, spin first
+	// and sleep only when that takes too long
+	adaptive_rwlock_lock(&rwlock);
+	
+	// modify the shared variable
+	shared_data = shared_data + 1;
+	
+	// release the lock, wakes the parked threads if there are any
+	adaptive_rwlock_unlock(&rwlock);
+	return NULL;
+}
+
+void *reader(void *arg) {
+	// increment the reader count in the state word
+	adaptive_rwlock_lock_shared(&rwlock);
+
+	// reading the shared variable
+	printf("%d ", shared_data);
+	
+	// decrement the reader count, the last reader wakes a waiting writer
+	adaptive_rwlock_unlock_shared(&rwlock);
+	return NULL;
+}	
+
+int main() {
+	adaptive_rwlock_init(&rwlock);
+
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 writers thread
+	int noOfWriters = 5;
+	pthread_t writerThread[noOfWriters];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_create(&writerThread[i], NULL, writer, NULL);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_join(writerThread[i], NULL);
+	}
+	
+	printf("\nAll readers-writers threads exited.\n");
+
+	// print contention statistics of the lock
+	adaptive_rwlock_print_stats(&rwlock, stdout);
+
+	return 0;
+
+}
@@ -0,0 +1,93 @@
+/*
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks
+ *
+ *  In this post we are going to implement reader-writer lock for machines
+ *  with several NUMA nodes (sockets) using lock cohorting, see cohort_lock.h.
+ *  Writers first take a lock of their own node and hand the global lock to
+ *  the next writer of the same node, so the lock and the shared data move
+ *  between sockets once per batch of writers instead of once per writer.
+ *  Readers count themselves per node. The node layout is read from sysfs.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name>
+ */
+
+# include <stdio.h>
+# include <pthread.h>
+# include "cohort_lock.h"
+
+// cohort lock, one writer lock and reader counter per NUMA node
+cohort_rwlock_t cohort_lock;
+// shared variable between reader and writer threads
+int shared_data;
+
+void *writer(void *arg) {
+	// take the lock of this node, then the global lock unless a writer
+	// of this node handed it over, and wait for the readers to leave
+	cohort_rwlock_lock(&cohort_lock);
+
+	// modify the shared variable
+	shared_data = shared_data + 1;
+
+	// pass the lock to the next writer of this node, or release it
+	cohort_rwlock_unlock(&cohort_lock);
+	return NULL;
+}
+
+void *reader(void *arg) {
+	// increment the reader counter of this node
+	cohort_rwlock_lock_shared(&cohort_lock);
+
+	// reading the shared variable
+	printf("%d ", shared_data);
+
+	// decrement the reader counter of this node
+	cohort_rwlock_unlock_shared(&cohort_lock);
+	return NULL;
+}
+
+int main() {
+	// read the NUMA topology and initialize the node locks
+	cohort_rwlock_init(&cohort_lock);
+	printf("%d NUMA node(s)\n", cohort_node_count());
+
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 writers thread
+	int noOfWriters = 5;
+	pthread_t writerThread[noOfWriters];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_create(&writerThread[i], NULL, writer, NULL);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_join(writerThread[i], NULL);
+	}
+
+	cohort_rwlock_destroy(&cohort_lock);
+
+	printf("\nAll readers-writers threads exited.\n");
+
+	return 0;
+
+}
@@ -0,0 +1,101 @@
+/*  
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks 
+ *
+ *  In this post we are going to implement reader-writer lock
+ *  directly on Linux futexes (see futex_rwlock.h). Reader count, writer
+ *  and waiters flags all live in one atomic word, so taking and releasing
+ *  the lock without contention is one atomic instruction, and threads only
+ *  enter the kernel when they really have to sleep or wake someone.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *  add -DRW_TRACE to write a timeline of the threads into trace.json (see trace.h)
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name>
+ */
+
+# include <stdio.h>
+# include <pthread.h>
+# include "futex_rwlock.h"
+
+// futex based reader-writer lock, a single atomic state word
+futex_rwlock_t rwlock = FUTEX_RWLOCK_INITIALIZER;
+// shared variable between reader and writer threads
+int shared_data;
+
+void *writer(void *arg) {
+	RW_TRACE_THREAD_START("writer");
+	// take the lock once no reader or writer is inside, new readers
+	// wait while this writer is waiting
+	RW_TRACE_BEGIN("write lock wait");
+	futex_rwlock_lock(&rwlock);
+	RW_TRACE_END("write lock wait");
+	
+	// modify the shared variable
+	RW_TRACE_BEGIN("write");
+	shared_data = shared_data + 1;
+	RW_TRACE_END("write");
+	
+	// release the lock, wakes the sleeping threads if there are any
+	futex_rwlock_unlock(&rwlock);
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}
+
+void *reader(void *arg) {
+	RW_TRACE_THREAD_START("reader");
+	// increment the reader count in the state word
+	RW_TRACE_BEGIN("read lock wait");
+	futex_rwlock_lock_shared(&rwlock);
+	RW_TRACE_END("read lock wait");
+
+	// reading the shared variable
+	RW_TRACE_BEGIN("read");
+	printf("%d ", shared_data);
+	RW_TRACE_END("read");
+	
+	// decrement the reader count, the last reader wakes a waiting writer
+	futex_rwlock_unlock_shared(&rwlock);
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}	
+
+int main() {
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 writers thread
+	int noOfWriters = 5;
+	pthread_t writerThread[noOfWriters];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_create(&writerThread[i], NULL, writer, NULL);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_join(writerThread[i], NULL);
+	}
+	
+	printf("\nAll readers-writers threads exited.\n");
+
+	RW_TRACE_DUMP("trace.json");
+
+	return 0;
+
+}
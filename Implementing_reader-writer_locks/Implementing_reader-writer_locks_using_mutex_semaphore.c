@@ -11,6 +11,7 @@
  *
  *  To compile this program run below cmd
  *  gcc <program-name> -lpthread  -o <output-file-name>
+ *  add -DRW_TRACE to write a timeline of the threads into trace.json (see trace.h)
  *
  *  To run this program run below cmd
  *  ./<output-file-name>
@@ -19,6 +20,7 @@
 # include <stdio.h>
 # include <pthread.h>
 # include <semaphore.h> 
+# include "trace.h"
 
 // mutex variable
 pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
@@ -30,19 +32,27 @@ int reader_count;
 int shared_data;
 
 void *writer(void *arg) {
+	RW_TRACE_THREAD_START("writer");
 	// execute wait semaphore to stop all writers and readers
 	// thread to enter into the critcal section
+	RW_TRACE_BEGIN("write lock wait");
 	sem_wait(&sem);
+	RW_TRACE_END("write lock wait");
 	
 	// modify the shared variable
+	RW_TRACE_BEGIN("write");
 	shared_data = shared_data + 1;
+	RW_TRACE_END("write");
 	
 	// Give signal to the writers and readers thread to 
 	// enter into the critical section
 	sem_post(&sem);
+	RW_TRACE_THREAD_STOP();
 }
 
 void *reader(void *arg) {
+	RW_TRACE_THREAD_START("reader");
+	RW_TRACE_BEGIN("read lock wait");
 	// taking mutex lock
 	pthread_mutex_lock(&lock);
 	// incrementing the reader count
@@ -54,9 +64,12 @@ void *reader(void *arg) {
 	}
 	// releasing mutex lock	
 	pthread_mutex_unlock(&lock);
+	RW_TRACE_END("read lock wait");
 
 	// reading the shared variable
+	RW_TRACE_BEGIN("read");
 	printf("%d ", shared_data);
+	RW_TRACE_END("read");
 	
 	// taking mutex lock
 	pthread_mutex_lock(&lock);
@@ -69,6 +82,7 @@ void *reader(void *arg) {
 	}	
 	// releasing mutex lock
 	pthread_mutex_unlock(&lock);		
+	RW_TRACE_THREAD_STOP();
 }	
 
 int main() {
@@ -106,6 +120,8 @@ int main() {
 	
 	printf("\nAll readers-writers threads exited.\n");
 
+	RW_TRACE_DUMP("trace.json");
+
 	return 0;
 
 }
@@ -0,0 +1,91 @@
+/*  
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks 
+ *
+ *  In this post we are going to implement reader-writer lock
+ *  using per thread reader counters (big-reader lock, see brlock.h).
+ *  Each reader only updates its own cache line padded counter instead
+ *  of a reader_count shared by all readers behind one mutex, so reads
+ *  scale with the no. of cores. Writers check every counter.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name>
+ */
+
+# include <stdio.h>
+# include <pthread.h>
+# include "brlock.h"
+
+// big-reader lock, one reader counter per thread
+brlock_t brlock;
+// shared variable between reader and writer threads
+int shared_data;
+
+void *writer(void *arg) {
+	// set the writer flag and wait until every reader counter is zero,
+	// new readers see the flag and wait for the writer
+	brlock_lock(&brlock);
+	
+	// modify the shared variable
+	shared_data = shared_data + 1;
+	
+	// clear the writer flag and let the waiting readers / writers in
+	brlock_unlock(&brlock);
+	return NULL;
+}
+
+void *reader(void *arg) {
+	// increment only this thread's own counter
+	brlock_lock_shared(&brlock);
+
+	// reading the shared variable
+	printf("%d ", shared_data);
+	
+	// decrement this thread's counter
+	brlock_unlock_shared(&brlock);
+	return NULL;
+}	
+
+int main() {
+	// initialize all reader counters with zero
+	brlock_init(&brlock);
+	
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 writers thread
+	int noOfWriters = 5;
+	pthread_t writerThread[noOfWriters];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_create(&writerThread[i], NULL, writer, NULL);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_join(writerThread[i], NULL);
+	}
+	
+	brlock_destroy(&brlock);
+	
+	printf("\nAll readers-writers threads exited.\n");
+
+	return 0;
+
+}
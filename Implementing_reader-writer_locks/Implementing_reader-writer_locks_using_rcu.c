@@ -0,0 +1,109 @@
+/*  
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks 
+ *
+ *  In this post we are going to use read-copy-update (see rcu.h) instead
+ *  of a lock. The shared data is published through a pointer, readers only
+ *  mark that they are reading and follow the pointer, writers never modify
+ *  the published copy: they build a new one, swap the pointer and free the
+ *  old copy once every reader that could still see it has finished.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name>
+ */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <pthread.h>
+# include "rcu.h"
+
+// shared state, a new copy is published on every write
+struct shared_state {
+	int shared_data;
+};
+
+// rcu domain tracking the readers of shared
+rcu_domain_t rcu;
+// currently published copy of the shared state
+_Atomic(struct shared_state *) shared;
+// mutex variable, serializes the writers among themselves only
+pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void *writer(void *arg) {
+	pthread_mutex_lock(&writer_lock);
+	// copy the published state and modify the copy
+	struct shared_state *old_state = atomic_load(&shared);
+	struct shared_state *new_state = malloc(sizeof(*new_state));
+	*new_state = *old_state;
+	new_state->shared_data = new_state->shared_data + 1;
+	// publish the new copy, readers from now on see it
+	rcu_assign_pointer(shared, new_state);
+	pthread_mutex_unlock(&writer_lock);
+
+	// wait for the readers that may still use the old copy, then free it
+	synchronize_rcu(&rcu);
+	free(old_state);
+	return NULL;
+}
+
+void *reader(void *arg) {
+	rcu_register_thread(&rcu);
+
+	// enter read section, no lock and no waiting on writers
+	rcu_read_lock(&rcu);
+	struct shared_state *state = rcu_dereference(shared);
+	// reading the shared variable
+	printf("%d ", state->shared_data);
+	// leave read section, the copy may be freed after this
+	rcu_read_unlock(&rcu);
+
+	rcu_unregister_thread(&rcu);
+	return NULL;
+}	
+
+int main() {
+	rcu_init(&rcu);
+	// publish the initial state
+	struct shared_state *initial = malloc(sizeof(*initial));
+	initial->shared_data = 0;
+	rcu_assign_pointer(shared, initial);
+	
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 writers thread
+	int noOfWriters = 5;
+	pthread_t writerThread[noOfWriters];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_create(&writerThread[i], NULL, writer, NULL);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_join(writerThread[i], NULL);
+	}
+
+	free(atomic_load(&shared));
+	
+	printf("\nAll readers-writers threads exited.\n");
+
+	return 0;
+
+}
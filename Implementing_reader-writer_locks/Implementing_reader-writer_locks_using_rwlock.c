@@ -0,0 +1,112 @@
+/*
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks
+ *
+ *  In this post we are going to use the reusable reader-writer lock from
+ *  rwlock.h. Unlike the mutex/semaphore and conditional variable programs,
+ *  which always prefer readers, the policy is selectable: reader preferring,
+ *  writer preferring or phase fair, the last two never starve the writers.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *  add -DRW_TRACE to write a timeline of the threads into trace.json (see trace.h)
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name> [reader | writer | phase]
+ */
+
+# include <stdio.h>
+# include <string.h>
+# include <pthread.h>
+# include "rwlock.h"
+
+// reader-writer lock protecting the shared data
+rwlock_t rwlock;
+// shared variable between reader and writer threads
+int shared_data;
+
+void *writer(void *arg) {
+	RW_TRACE_THREAD_START("writer");
+	// wait until no reader or writer is inside the critical section
+	RW_TRACE_BEGIN("write lock wait");
+	rwlock_lock(&rwlock);
+	RW_TRACE_END("write lock wait");
+
+	// modify the shared variable
+	RW_TRACE_BEGIN("write");
+	shared_data = shared_data + 1;
+	RW_TRACE_END("write");
+
+	// let the waiting writers / readers in, in the order the policy decides
+	rwlock_unlock(&rwlock);
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}
+
+void *reader(void *arg) {
+	RW_TRACE_THREAD_START("reader");
+	// enter together with the other readers unless a writer is inside
+	// (or, depending on the policy, waiting)
+	RW_TRACE_BEGIN("read lock wait");
+	rwlock_lock_shared(&rwlock);
+	RW_TRACE_END("read lock wait");
+
+	// reading the shared variable
+	RW_TRACE_BEGIN("read");
+	printf("%d ", shared_data);
+	RW_TRACE_END("read");
+
+	// the last reader leaving lets a waiting writer in
+	rwlock_unlock_shared(&rwlock);
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	// select the lock policy, writer preferring by default
+	enum rwlock_policy policy = RWLOCK_PREFER_WRITER;
+	if (argc > 1 && strcmp(argv[1], "reader") == 0) {
+		policy = RWLOCK_PREFER_READER;
+	} else if (argc > 1 && strcmp(argv[1], "phase") == 0) {
+		policy = RWLOCK_PHASE_FAIR;
+	}
+	rwlock_init(&rwlock, policy);
+
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 writers thread
+	int noOfWriters = 5;
+	pthread_t writerThread[noOfWriters];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_create(&writerThread[i], NULL, writer, NULL);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_join(writerThread[i], NULL);
+	}
+
+	rwlock_destroy(&rwlock);
+
+	printf("\nAll readers-writers threads exited.\n");
+
+	RW_TRACE_DUMP("trace.json");
+
+	return 0;
+
+}
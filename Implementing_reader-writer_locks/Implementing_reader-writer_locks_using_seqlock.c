@@ -0,0 +1,94 @@
+/*  
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks 
+ *
+ *  In this post we are going to use a sequence lock (see seqlock.h).
+ *  shared_data is a plain int, so readers do not need to keep the writer
+ *  out at all: they read optimistically and retry if a writer changed the
+ *  sequence counter meanwhile. Readers take no lock and write nothing.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name>
+ */
+
+# include <stdio.h>
+# include <pthread.h>
+# include <stdatomic.h>
+# include "seqlock.h"
+
+// sequence lock, writers serialize on it, readers only read its counter
+seqlock_t seqlock;
+// shared variable between reader and writer threads, accessed with relaxed
+// atomics as readers may read it while a writer is changing it
+atomic_int shared_data;
+
+void *writer(void *arg) {
+	// make the sequence odd so readers know a write is in progress
+	seqlock_write_lock(&seqlock);
+	
+	// modify the shared variable
+	atomic_store_explicit(&shared_data,
+		atomic_load_explicit(&shared_data, memory_order_relaxed) + 1, memory_order_relaxed);
+	
+	// make the sequence even again, readers that overlapped will retry
+	seqlock_write_unlock(&seqlock);
+	return NULL;
+}
+
+void *reader(void *arg) {
+	unsigned int start;
+	int value;
+
+	// read until no writer ran in the middle of the read
+	do {
+		start = seqlock_read_begin(&seqlock);
+		value = atomic_load_explicit(&shared_data, memory_order_relaxed);
+	} while (seqlock_read_retry(&seqlock, start));
+
+	// print the consistent copy
+	printf("%d ", value);
+	return NULL;
+}	
+
+int main() {
+	seqlock_init(&seqlock);
+	
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 writers thread
+	int noOfWriters = 5;
+	pthread_t writerThread[noOfWriters];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_create(&writerThread[i], NULL, writer, NULL);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_join(writerThread[i], NULL);
+	}
+	
+	seqlock_destroy(&seqlock);
+	
+	printf("\nAll readers-writers threads exited.\n");
+
+	return 0;
+
+}
@@ -0,0 +1,95 @@
+/*
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks
+ *
+ *  In this post the shared data is not a single int but a table of keys
+ *  and values, see striped_map.h. Instead of one reader-writer lock for
+ *  the whole table the keys are split over stripes with a lock each, so
+ *  readers and writers of keys in different stripes never wait for each
+ *  other and a stripe grows without stopping the others. Every writer
+ *  increments its own key, every reader prints one key.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name>
+ */
+
+# include <stdio.h>
+# include <pthread.h>
+# include "striped_map.h"
+
+// shared table between reader and writer threads, 8 stripes
+striped_map_t shared_map;
+
+void *writer(void *arg) {
+	int key = *(int *)arg, value;
+
+	// write lock only the stripe of this key and increment its value,
+	// the key is inserted with 0 first if it is not there yet
+	striped_map_add(&shared_map, key, 1, &value);
+	return NULL;
+}
+
+void *reader(void *arg) {
+	int key = *(int *)arg, value = 0;
+
+	// read lock only the stripe of this key
+	striped_map_get(&shared_map, key, &value);
+	printf("%d=%d ", key, value);
+	return NULL;
+}
+
+void print_entry(int key, int value, void *arg) {
+	printf("%d=%d ", key, value);
+}
+
+int main() {
+	striped_map_init(&shared_map, 8);
+
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 writers thread
+	int noOfWriters = 5;
+	pthread_t writerThread[noOfWriters];
+	// key of every thread
+	int keys[noOfReaders];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		keys[i] = i % noOfWriters;
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, &keys[i]);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_create(&writerThread[i], NULL, writer, &keys[i]);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfWriters; ++i) {
+		pthread_join(writerThread[i], NULL);
+	}
+
+	printf("\nfinal table: ");
+	striped_map_for_each(&shared_map, print_entry, NULL);
+
+	striped_map_destroy(&shared_map);
+
+	printf("\nAll readers-writers threads exited.\n");
+
+	return 0;
+
+}
@@ -0,0 +1,112 @@
+/*
+ *  Write a program where multiple readers allowed to access shared data concurrently
+ *  but only one writer allowed to access the shared data, if there is writer thread
+ *  accessing the shared data then no others readers / writers allowed to access
+ *  the shared data.
+ *
+ *  Basically we have to implement reader-writer locks
+ *
+ *  In this post we are going to add an updater, a read-modify-write thread
+ *  that reads the shared data and only writes it when it is even. Taking
+ *  the writer lock for that would keep every reader out even when nothing
+ *  gets written, so the updater takes the rwlock.h lock upgradable instead:
+ *  it reads together with the readers and only upgrades to the writer when
+ *  it has to write. After writing it downgrades back to a reader to print
+ *  the value it wrote, readers can already come in, other writers can not.
+ *
+ *  To compile this program run below cmd
+ *  gcc <program-name> -lpthread  -o <output-file-name>
+ *
+ *  To run this program run below cmd
+ *  ./<output-file-name> [reader | writer | phase]
+ */
+
+# include <stdio.h>
+# include <string.h>
+# include <pthread.h>
+# include "rwlock.h"
+
+// reader-writer lock protecting the shared data
+rwlock_t rwlock;
+// shared variable between reader and updater threads
+int shared_data;
+
+void *updater(void *arg) {
+	// enter together with the readers, but as the only updater
+	rwlock_lock_upgradable(&rwlock);
+
+	// nothing to do for odd values, leave like a reader
+	if (shared_data % 2 != 0) {
+		rwlock_unlock_upgradable(&rwlock);
+		return NULL;
+	}
+
+	// wait for the readers to leave, no writer can get in before us so
+	// the value we read is still the current one
+	rwlock_upgrade(&rwlock);
+
+	// modify the shared variable
+	shared_data = shared_data + 1;
+
+	// become a reader again, the readers waiting enter with us
+	rwlock_downgrade(&rwlock);
+
+	// what we wrote can not have changed yet
+	printf("[%d] ", shared_data);
+
+	rwlock_unlock_shared(&rwlock);
+	return NULL;
+}
+
+void *reader(void *arg) {
+	rwlock_lock_shared(&rwlock);
+
+	// reading the shared variable
+	printf("%d ", shared_data);
+
+	rwlock_unlock_shared(&rwlock);
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	// select the lock policy, writer preferring by default
+	enum rwlock_policy policy = RWLOCK_PREFER_WRITER;
+	if (argc > 1 && strcmp(argv[1], "reader") == 0) {
+		policy = RWLOCK_PREFER_READER;
+	} else if (argc > 1 && strcmp(argv[1], "phase") == 0) {
+		policy = RWLOCK_PHASE_FAIR;
+	}
+	rwlock_init(&rwlock, policy);
+
+	// create 10 readers thread
+	int noOfReaders = 10;
+	pthread_t readerThread[noOfReaders];
+	// create 5 updaters thread
+	int noOfUpdaters = 5;
+	pthread_t updaterThread[noOfUpdaters];
+
+	int i;
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_create(&readerThread[i], NULL, reader, NULL);
+	}
+
+	for (i = 0; i < noOfUpdaters; ++i) {
+		pthread_create(&updaterThread[i], NULL, updater, NULL);
+	}
+
+	for (i = 0; i < noOfReaders; ++i) {
+		pthread_join(readerThread[i], NULL);
+	}
+
+	for (i = 0; i < noOfUpdaters; ++i) {
+		pthread_join(updaterThread[i], NULL);
+	}
+
+	rwlock_destroy(&rwlock);
+
+	printf("\nAll readers-updaters threads exited.\n");
+
+	return 0;
+
+}
@@ -0,0 +1,165 @@
+/*
+ *  Adaptive spin-then-park reader-writer lock with contention statistics.
+ *
+ *  The mutex/semaphore and conditional variable programs put a thread to
+ *  sleep as soon as the lock is busy, even though the critical section is
+ *  a single increment of shared_data and the lock will be free again long
+ *  before the two context switches of sleeping and waking are done.
+ *
+ *  adaptive_rwlock_t first tries to take the futex lock from futex_rwlock.h
+ *  for a short spin window, waiting between attempts with the cpu pause
+ *  instruction and doubling the wait every time (exponential backoff, so
+ *  spinning threads do not hammer the lock's cache line). Only when the
+ *  window is used up it parks the thread on the futex. On a single cpu
+ *  spinning cannot help (the holder is not running) so the window is 0.
+ *
+ *  Every lock counts acquisitions, contended acquisitions, acquisitions that
+ *  had to park and the time spent spinning and parked, see
+ *  adaptive_rwlock_print_stats. The fast path counts into a cache line padded
+ *  slot of its own thread, so the uncontended lock does not bounce a shared
+ *  counter line between cpus, the slots are summed when printing.
+ *
+ *  Include this header and compile with -lpthread (C11 for stdatomic.h)
+ */
+
+# ifndef ADAPTIVE_LOCK_H
+# define ADAPTIVE_LOCK_H
+
+# include <stdio.h>
+# include <time.h>
+# include <unistd.h>
+# include <stdatomic.h>
+# include "futex_rwlock.h"
+
+// default spin window, a count of pause instructions not a time: a pause
+// takes from about 10 to over 100 cycles depending on the cpu model
+# define ADAPTIVE_SPIN_LIMIT 4096
+// longest single backoff in pause instructions
+# define ADAPTIVE_MAX_BACKOFF 256
+// no. of per thread acquisition counters, threads beyond share them
+# define ADAPTIVE_STAT_SLOTS 64
+# define ADAPTIVE_CACHE_LINE 64
+
+typedef struct {
+	atomic_ullong count;
+	char pad[ADAPTIVE_CACHE_LINE - sizeof(atomic_ullong)];
+} __attribute__((aligned(ADAPTIVE_CACHE_LINE))) adaptive_counter_t;
+
+typedef struct {
+	adaptive_counter_t acquisitions[ADAPTIVE_STAT_SLOTS];
+	atomic_ullong contended;
+	atomic_ullong parked;
+	atomic_ullong spin_ns;
+	atomic_ullong park_ns;
+} lock_stats_t;
+
+typedef struct {
+	futex_rwlock_t lock;
+	// no. of pause instructions to spin before parking
+	unsigned int spin_limit;
+	lock_stats_t stats;
+} adaptive_rwlock_t;
+
+// tell the cpu this is a spin wait loop
+static inline void cpu_relax(void) {
+# if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+# elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+# endif
+}
+
+// counter slot of the calling thread, handed out on its first acquisition
+static atomic_uint adaptive_next_slot;
+static __thread int adaptive_thread_slot = -1;
+
+static inline atomic_ullong *adaptive_acquisitions(adaptive_rwlock_t *rw) {
+	if (adaptive_thread_slot < 0) {
+		adaptive_thread_slot = atomic_fetch_add_explicit(&adaptive_next_slot, 1, memory_order_relaxed) % ADAPTIVE_STAT_SLOTS;
+	}
+	return &rw->stats.acquisitions[adaptive_thread_slot].count;
+}
+
+static inline unsigned long long adaptive_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void adaptive_rwlock_init(adaptive_rwlock_t *rw) {
+	futex_rwlock_init(&rw->lock);
+	int i;
+	rw->spin_limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? ADAPTIVE_SPIN_LIMIT : 0;
+	for (i = 0; i < ADAPTIVE_STAT_SLOTS; ++i) {
+		atomic_init(&rw->stats.acquisitions[i].count, 0);
+	}
+	atomic_init(&rw->stats.contended, 0);
+	atomic_init(&rw->stats.parked, 0);
+	atomic_init(&rw->stats.spin_ns, 0);
+	atomic_init(&rw->stats.park_ns, 0);
+}
+
+// slow path shared by readers and writers: spin with exponential backoff
+// calling try_lock, then park with lock
+static inline void adaptive_rwlock_contended(adaptive_rwlock_t *rw,
+		int (*try_lock)(futex_rwlock_t *), void (*lock)(futex_rwlock_t *)) {
+	unsigned long long start = adaptive_now_ns();
+	unsigned int spun = 0, backoff = 1, i;
+
+	atomic_fetch_add_explicit(&rw->stats.contended, 1, memory_order_relaxed);
+	while (spun < rw->spin_limit) {
+		for (i = 0; i < backoff; ++i) {
+			cpu_relax();
+		}
+		spun = spun + backoff;
+		if (backoff < ADAPTIVE_MAX_BACKOFF) {
+			backoff = backoff * 2;
+		}
+		if (try_lock(&rw->lock)) {
+			atomic_fetch_add_explicit(&rw->stats.spin_ns, adaptive_now_ns() - start, memory_order_relaxed);
+			return;
+		}
+	}
+
+	// spin window used up, sleep on the futex
+	unsigned long long parked = adaptive_now_ns();
+	atomic_fetch_add_explicit(&rw->stats.spin_ns, parked - start, memory_order_relaxed);
+	lock(&rw->lock);
+	atomic_fetch_add_explicit(&rw->stats.park_ns, adaptive_now_ns() - parked, memory_order_relaxed);
+	atomic_fetch_add_explicit(&rw->stats.parked, 1, memory_order_relaxed);
+}
+
+static inline void adaptive_rwlock_lock_shared(adaptive_rwlock_t *rw) {
+	atomic_fetch_add_explicit(adaptive_acquisitions(rw), 1, memory_order_relaxed);
+	if (!futex_rwlock_try_lock_shared(&rw->lock)) {
+		adaptive_rwlock_contended(rw, futex_rwlock_try_lock_shared, futex_rwlock_lock_shared);
+	}
+}
+
+static inline void adaptive_rwlock_unlock_shared(adaptive_rwlock_t *rw) {
+	futex_rwlock_unlock_shared(&rw->lock);
+}
+
+static inline void adaptive_rwlock_lock(adaptive_rwlock_t *rw) {
+	atomic_fetch_add_explicit(adaptive_acquisitions(rw), 1, memory_order_relaxed);
+	if (!futex_rwlock_try_lock(&rw->lock)) {
+		adaptive_rwlock_contended(rw, futex_rwlock_try_lock, futex_rwlock_lock);
+	}
+}
+
+static inline void adaptive_rwlock_unlock(adaptive_rwlock_t *rw) {
+	futex_rwlock_unlock(&rw->lock);
+}
+
+static inline void adaptive_rwlock_print_stats(adaptive_rwlock_t *rw, FILE *out) {
+	unsigned long long acquisitions = 0, contended = atomic_load(&rw->stats.contended);
+	int i;
+	for (i = 0; i < ADAPTIVE_STAT_SLOTS; ++i) {
+		acquisitions += atomic_load(&rw->stats.acquisitions[i].count);
+	}
+	fprintf(out, "acquisitions %llu, contended %llu, parked %llu, spin %llu us, parked %llu us\n",
+		acquisitions, contended, atomic_load(&rw->stats.parked),
+		atomic_load(&rw->stats.spin_ns) / 1000, atomic_load(&rw->stats.park_ns) / 1000);
+}
+
+# endif
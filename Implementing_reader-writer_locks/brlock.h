@@ -0,0 +1,108 @@
+/*
+ *  Big-reader (distributed) reader-writer lock for read mostly data.
+ *
+ *  In the mutex/semaphore and conditional variable programs every reader
+ *  takes the same mutex twice to update the single reader_count, so the
+ *  cache line of that mutex moves between all cores on every read and
+ *  read throughput stops scaling after a few threads.
+ *
+ *  Here every thread gets its own reader counter padded to a full cache
+ *  line. A reader only increments and decrements its own counter and reads
+ *  the writer flag, which stays shared in every core's cache while no
+ *  writer is active, so readers on different cores never touch the same
+ *  line. A writer sets the writer flag and waits until all counters are
+ *  zero, writes are expensive (O(no. of slots)) which is the price for
+ *  reads that scale with the no. of cores.
+ *
+ *  Threads beyond BRLOCK_SLOTS share slots, that stays correct since
+ *  slots are counters, only the sharing threads' lines are contended.
+ *
+ *  Include this header and compile with -lpthread (C11 for stdatomic.h)
+ */
+
+# ifndef BRLOCK_H
+# define BRLOCK_H
+
+# include <pthread.h>
+# include <sched.h>
+# include <stdatomic.h>
+
+# define BRLOCK_SLOTS 64
+# define BRLOCK_CACHE_LINE 64
+
+// reader counter alone on its cache line
+typedef struct {
+	atomic_int readers;
+	char pad[BRLOCK_CACHE_LINE - sizeof(atomic_int)];
+} __attribute__((aligned(BRLOCK_CACHE_LINE))) brlock_slot_t;
+
+typedef struct {
+	brlock_slot_t slots[BRLOCK_SLOTS];
+	// 1 while a writer holds or is acquiring the lock, own cache line
+	atomic_int writer __attribute__((aligned(BRLOCK_CACHE_LINE)));
+	// serializes writers, readers that find a writer sleep on it
+	pthread_mutex_t writer_mutex;
+} brlock_t;
+
+// slot of the calling thread, handed out round robin on first use
+static atomic_uint brlock_next_slot;
+static __thread int brlock_thread_slot = -1;
+
+static inline int brlock_my_slot(void) {
+	if (brlock_thread_slot < 0) {
+		brlock_thread_slot = atomic_fetch_add(&brlock_next_slot, 1) % BRLOCK_SLOTS;
+	}
+	return brlock_thread_slot;
+}
+
+static inline void brlock_init(brlock_t *br) {
+	int i;
+	for (i = 0; i < BRLOCK_SLOTS; ++i) {
+		atomic_init(&br->slots[i].readers, 0);
+	}
+	atomic_init(&br->writer, 0);
+	pthread_mutex_init(&br->writer_mutex, NULL);
+}
+
+static inline void brlock_destroy(brlock_t *br) {
+	pthread_mutex_destroy(&br->writer_mutex);
+}
+
+static inline void brlock_lock_shared(brlock_t *br) {
+	atomic_int *readers = &br->slots[brlock_my_slot()].readers;
+	while (1) {
+		// announce the reader, then check for a writer; both sequentially
+		// consistent so a writer either sees this count or we see its flag
+		atomic_fetch_add(readers, 1);
+		if (!atomic_load(&br->writer)) {
+			return;
+		}
+		// a writer is in or on its way, back off and sleep until it is done
+		atomic_fetch_sub(readers, 1);
+		pthread_mutex_lock(&br->writer_mutex);
+		pthread_mutex_unlock(&br->writer_mutex);
+	}
+}
+
+static inline void brlock_unlock_shared(brlock_t *br) {
+	atomic_fetch_sub_explicit(&br->slots[brlock_my_slot()].readers, 1, memory_order_release);
+}
+
+static inline void brlock_lock(brlock_t *br) {
+	int i;
+	pthread_mutex_lock(&br->writer_mutex);
+	atomic_store(&br->writer, 1);
+	// wait for the readers already inside, new readers see the flag and back off
+	for (i = 0; i < BRLOCK_SLOTS; ++i) {
+		while (atomic_load(&br->slots[i].readers) != 0) {
+			sched_yield();
+		}
+	}
+}
+
+static inline void brlock_unlock(brlock_t *br) {
+	atomic_store(&br->writer, 0);
+	pthread_mutex_unlock(&br->writer_mutex);
+}
+
+# endif
@@ -0,0 +1,275 @@
+/*
+ *  NUMA-aware (cohort) reader-writer lock.
+ *
+ *  On a machine with several sockets every acquire of a single global lock
+ *  moves its cache line, and the protected data with it, to the socket of
+ *  the new owner. When writers on all sockets take turns, nearly every
+ *  handover crosses the interconnect.
+ *
+ *  Lock cohorting keeps the handovers on one node:
+ *
+ *  - every NUMA node has its own ticket lock, a writer first takes the
+ *    lock of the node it runs on, so waiters spin only on node local lines
+ *  - the first writer of a node then takes the global lock
+ *  - a writer leaving while another writer of its node waits passes the
+ *    node lock on and keeps the global lock for the node, up to
+ *    COHORT_BATCH writers in a row, then the global lock goes to the
+ *    next node so no node starves
+ *
+ *  The global lock is released by whichever writer of the cohort is last,
+ *  not by the one that took it, so it is a futex word rather than a
+ *  pthread mutex (unlocking a mutex from another thread is undefined).
+ *
+ *  Readers count themselves in a counter of their node, padded to its own
+ *  cache line, so readers on different nodes never share a line. They wait
+ *  while the writer flag is set, which it is for as long as one cohort
+ *  holds the global lock, and a writer waits for all node counters to
+ *  drain before it goes in. Writers are preferred, a batch limit bounds
+ *  how long one node keeps the lock but not how long readers wait.
+ *
+ *  The node of every CPU is read from /sys/devices/system/node/node<N>/cpulist
+ *  once. A thread looks up its node with getcpu on its first lock and
+ *  keeps it, pin threads to get the full effect. Without the sysfs files
+ *  everything is node 0 and the lock behaves like a plain rwlock.
+ *
+ *  Include this header and compile with -lpthread (C11 for stdatomic.h)
+ */
+
+# ifndef COHORT_LOCK_H
+# define COHORT_LOCK_H
+
+# include <dirent.h>
+# include <limits.h>
+# include <pthread.h>
+# include <sched.h>
+# include <stdatomic.h>
+# include <stdint.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <unistd.h>
+# include <linux/futex.h>
+# include <sys/syscall.h>
+
+# define COHORT_MAX_NODES 64
+# define COHORT_MAX_CPUS 4096
+# define COHORT_CACHE_LINE 64
+// no. of writers of one node served in a row before the global lock moves on
+# define COHORT_BATCH 64
+// no. of spins before a waiting thread yields the cpu
+# define COHORT_SPIN_LIMIT 128
+
+// per node writer lock and reader counter, each alone on its cache line
+typedef struct {
+	atomic_uint next_ticket;
+	atomic_uint now_serving;
+	// only touched by the holder of this node lock
+	int owns_global;
+	int batch;
+} __attribute__((aligned(COHORT_CACHE_LINE))) cohort_node_t;
+
+typedef struct {
+	atomic_int readers;
+} __attribute__((aligned(COHORT_CACHE_LINE))) cohort_readers_t;
+
+typedef struct {
+	cohort_node_t nodes[COHORT_MAX_NODES];
+	cohort_readers_t readers[COHORT_MAX_NODES];
+	// 0 free, 1 held, 2 held and someone sleeps on it
+	atomic_int global __attribute__((aligned(COHORT_CACHE_LINE)));
+	// 1 while a cohort of writers holds the global lock, readers stay out
+	atomic_int writer;
+} cohort_rwlock_t;
+
+// node of every cpu and no. of nodes, read from sysfs once
+static int cohort_cpu_node[COHORT_MAX_CPUS];
+static int cohort_nodes = 1;
+static pthread_once_t cohort_topology_once = PTHREAD_ONCE_INIT;
+// node of the calling thread
+static __thread int cohort_thread_node = -1;
+
+// parse a cpulist like "0-3,8-11" and map its cpus to given node
+static inline void cohort_read_cpulist(FILE *list, int node) {
+	int first, last;
+	char separator;
+	while (fscanf(list, "%d", &first) == 1) {
+		last = first;
+		separator = fgetc(list);
+		if (separator == '-') {
+			if (fscanf(list, "%d", &last) != 1) {
+				return;
+			}
+			separator = fgetc(list);
+		}
+		for (; first <= last && first < COHORT_MAX_CPUS; ++first) {
+			cohort_cpu_node[first] = node;
+		}
+		if (separator != ',') {
+			return;
+		}
+	}
+}
+
+// number the nodes found in sysfs 0, 1, 2 ... in directory order
+static inline void cohort_read_topology(void) {
+	DIR *dir = opendir("/sys/devices/system/node");
+	struct dirent *entry;
+	char path[PATH_MAX];
+	int id, nodes = 0;
+
+	if (dir == NULL) {
+		return;
+	}
+	while ((entry = readdir(dir)) != NULL && nodes < COHORT_MAX_NODES) {
+		if (sscanf(entry->d_name, "node%d", &id) != 1) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "/sys/devices/system/node/%s/cpulist", entry->d_name);
+		FILE *list = fopen(path, "r");
+		if (list == NULL) {
+			continue;
+		}
+		cohort_read_cpulist(list, nodes);
+		fclose(list);
+		nodes = nodes + 1;
+	}
+	closedir(dir);
+	if (nodes > 0) {
+		cohort_nodes = nodes;
+	}
+}
+
+// return no. of NUMA nodes the lock spreads over
+static inline int cohort_node_count(void) {
+	pthread_once(&cohort_topology_once, cohort_read_topology);
+	return cohort_nodes;
+}
+
+static inline int cohort_my_node(void) {
+	if (cohort_thread_node < 0) {
+		unsigned int cpu;
+		cohort_node_count();
+		if (syscall(SYS_getcpu, &cpu, NULL, NULL) != 0) {
+			cpu = 0;
+		}
+		cohort_thread_node = cpu < COHORT_MAX_CPUS ? cohort_cpu_node[cpu] : 0;
+	}
+	return cohort_thread_node;
+}
+
+static inline void cohort_relax(unsigned int *spins) {
+	if (++*spins < COHORT_SPIN_LIMIT) {
+# if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+# elif defined(__aarch64__)
+		__asm__ __volatile__("yield");
+# endif
+	} else {
+		sched_yield();
+	}
+}
+
+static inline void cohort_rwlock_init(cohort_rwlock_t *rw) {
+	int i;
+	cohort_node_count();
+	for (i = 0; i < COHORT_MAX_NODES; ++i) {
+		atomic_init(&rw->nodes[i].next_ticket, 0);
+		atomic_init(&rw->nodes[i].now_serving, 0);
+		rw->nodes[i].owns_global = 0;
+		rw->nodes[i].batch = 0;
+		atomic_init(&rw->readers[i].readers, 0);
+	}
+	atomic_init(&rw->global, 0);
+	atomic_init(&rw->writer, 0);
+}
+
+static inline void cohort_rwlock_destroy(cohort_rwlock_t *rw) {
+	(void)rw;
+}
+
+// global lock, a futex mutex any thread may unlock
+static inline void cohort_global_lock(cohort_rwlock_t *rw) {
+	int state = 0;
+	if (atomic_compare_exchange_strong(&rw->global, &state, 1)) {
+		return;
+	}
+	// mark the lock contended and sleep until it is free
+	while (atomic_exchange(&rw->global, 2) != 0) {
+		syscall(SYS_futex, (uint32_t *)&rw->global, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+	}
+}
+
+static inline void cohort_global_unlock(cohort_rwlock_t *rw) {
+	if (atomic_exchange(&rw->global, 0) == 2) {
+		syscall(SYS_futex, (uint32_t *)&rw->global, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	}
+}
+
+static inline void cohort_rwlock_lock_shared(cohort_rwlock_t *rw) {
+	atomic_int *readers = &rw->readers[cohort_my_node()].readers;
+	unsigned int spins = 0;
+	while (1) {
+		// announce the reader, then check for a writer; both sequentially
+		// consistent so a writer either sees this count or we see its flag
+		atomic_fetch_add(readers, 1);
+		if (!atomic_load(&rw->writer)) {
+			return;
+		}
+		atomic_fetch_sub(readers, 1);
+		while (atomic_load_explicit(&rw->writer, memory_order_relaxed)) {
+			cohort_relax(&spins);
+		}
+	}
+}
+
+static inline void cohort_rwlock_unlock_shared(cohort_rwlock_t *rw) {
+	atomic_fetch_sub_explicit(&rw->readers[cohort_my_node()].readers, 1, memory_order_release);
+}
+
+static inline void cohort_rwlock_lock(cohort_rwlock_t *rw) {
+	cohort_node_t *node = &rw->nodes[cohort_my_node()];
+	unsigned int ticket = atomic_fetch_add(&node->next_ticket, 1);
+	unsigned int spins = 0;
+	int i;
+
+	// wait for our turn among the writers of this node
+	while (atomic_load_explicit(&node->now_serving, memory_order_acquire) != ticket) {
+		cohort_relax(&spins);
+	}
+	// the writer before us on this node passed the global lock on with the
+	// node lock, readers are still held out
+	if (node->owns_global) {
+		return;
+	}
+
+	cohort_global_lock(rw);
+	node->owns_global = 1;
+	node->batch = 0;
+	// shut out new readers, wait for the ones inside on every node
+	atomic_store(&rw->writer, 1);
+	for (i = 0; i < cohort_nodes; ++i) {
+		spins = 0;
+		while (atomic_load(&rw->readers[i].readers) != 0) {
+			cohort_relax(&spins);
+		}
+	}
+}
+
+static inline void cohort_rwlock_unlock(cohort_rwlock_t *rw) {
+	cohort_node_t *node = &rw->nodes[cohort_my_node()];
+	unsigned int serving = atomic_load_explicit(&node->now_serving, memory_order_relaxed);
+
+	node->batch = node->batch + 1;
+	// another writer of this node waits, hand it the node lock and keep
+	// the global lock unless the node had its share
+	if (atomic_load(&node->next_ticket) - serving > 1 && node->batch < COHORT_BATCH) {
+		atomic_store_explicit(&node->now_serving, serving + 1, memory_order_release);
+		return;
+	}
+
+	node->owns_global = 0;
+	atomic_store(&rw->writer, 0);
+	cohort_global_unlock(rw);
+	atomic_store_explicit(&node->now_serving, serving + 1, memory_order_release);
+}
+
+# endif
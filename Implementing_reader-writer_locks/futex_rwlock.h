@@ -0,0 +1,179 @@
+/*
+ *  Reader-writer lock built directly on Linux futexes.
+ *
+ *  The whole lock is one 32 bit atomic state word:
+ *
+ *  bits 0 - 28  no. of readers inside
+ *  bit 29       FUTEX_RW_WRITER_PENDING - a writer is waiting, new readers
+ *               wait too so a stream of readers cannot starve the writer
+ *  bit 30       FUTEX_RW_WRITER - a writer is inside
+ *  bit 31       FUTEX_RW_WAITERS - some thread sleeps in futex_wait
+ *
+ *  Uncontended lock and unlock are a single atomic instruction each
+ *  (compare-exchange to enter, fetch-sub / exchange to leave) and never
+ *  enter the kernel. A thread that has to wait sets FUTEX_RW_WAITERS and
+ *  sleeps on the state word, and unlock only makes the futex_wake system
+ *  call when it sees that bit. Waiters are all woken and race again, the
+ *  ones that lose go back to sleep.
+ *
+ *  With -DRW_TRACE (see trace.h) every acquire and release, fast path
+ *  included, is a point event on the thread's timeline, an acquire that had
+ *  to wait is a span with the futex sleeps nested inside.
+ *
+ *  Include this header and compile with -lpthread (C11 for stdatomic.h)
+ */
+
+# ifndef FUTEX_RWLOCK_H
+# define FUTEX_RWLOCK_H
+
+# include <limits.h>
+# include <stdatomic.h>
+# include <stdint.h>
+# include <unistd.h>
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include "trace.h"
+
+# define FUTEX_RW_READERS        0x1fffffffu
+# define FUTEX_RW_WRITER_PENDING 0x20000000u
+# define FUTEX_RW_WRITER         0x40000000u
+# define FUTEX_RW_WAITERS        0x80000000u
+
+typedef struct {
+	atomic_uint state;
+} futex_rwlock_t;
+
+# define FUTEX_RWLOCK_INITIALIZER { 0 }
+
+// sleep while the state word still equals expected
+static inline void futex_rwlock_wait(futex_rwlock_t *rw, unsigned int expected) {
+	RW_TRACE_BEGIN("futex sleep");
+	syscall(SYS_futex, (uint32_t *)&rw->state, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+	RW_TRACE_END("futex sleep");
+}
+
+// wake every thread sleeping on the state word
+static inline void futex_rwlock_wake_all(futex_rwlock_t *rw) {
+	syscall(SYS_futex, (uint32_t *)&rw->state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline void futex_rwlock_init(futex_rwlock_t *rw) {
+	atomic_init(&rw->state, 0);
+}
+
+// set the waiters bit (and any extra bits) before sleeping, return the
+// state to sleep on or 0 if the state changed and the caller should retry
+static inline unsigned int futex_rwlock_announce(futex_rwlock_t *rw, unsigned int state, unsigned int bits) {
+	unsigned int want = state | FUTEX_RW_WAITERS | bits;
+	if (state != want && !atomic_compare_exchange_weak_explicit(&rw->state, &state, want,
+			memory_order_relaxed, memory_order_relaxed)) {
+		return 0;
+	}
+	return want;
+}
+
+// enter as a reader only if that needs no waiting, return 1 on success
+static inline int futex_rwlock_try_lock_shared(futex_rwlock_t *rw) {
+	unsigned int state = atomic_load_explicit(&rw->state, memory_order_relaxed);
+	while (!(state & (FUTEX_RW_WRITER | FUTEX_RW_WRITER_PENDING))) {
+		if (atomic_compare_exchange_weak_explicit(&rw->state, &state, state + 1,
+				memory_order_acquire, memory_order_relaxed)) {
+			RW_TRACE_INSTANT("read lock acquire");
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// enter as the writer only if that needs no waiting, return 1 on success
+static inline int futex_rwlock_try_lock(futex_rwlock_t *rw) {
+	unsigned int state = atomic_load_explicit(&rw->state, memory_order_relaxed);
+	while (!(state & (FUTEX_RW_READERS | FUTEX_RW_WRITER))) {
+		if (atomic_compare_exchange_weak_explicit(&rw->state, &state,
+				(state & FUTEX_RW_WAITERS) | FUTEX_RW_WRITER,
+				memory_order_acquire, memory_order_relaxed)) {
+			RW_TRACE_INSTANT("write lock acquire");
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static inline void futex_rwlock_lock_shared(futex_rwlock_t *rw) {
+	unsigned int state = atomic_load_explicit(&rw->state, memory_order_relaxed);
+	int contended = 0;
+	while (1) {
+		if (!(state & (FUTEX_RW_WRITER | FUTEX_RW_WRITER_PENDING))) {
+			if (atomic_compare_exchange_weak_explicit(&rw->state, &state, state + 1,
+					memory_order_acquire, memory_order_relaxed)) {
+				if (contended) {
+					RW_TRACE_END("read lock contend");
+				}
+				RW_TRACE_INSTANT("read lock acquire");
+				return;
+			}
+			continue;
+		}
+		if (!contended) {
+			RW_TRACE_BEGIN("read lock contend");
+			contended = 1;
+		}
+		// writer inside or waiting, sleep until the state word changes
+		unsigned int sleep_on = futex_rwlock_announce(rw, state, 0);
+		if (sleep_on) {
+			futex_rwlock_wait(rw, sleep_on);
+		}
+		state = atomic_load_explicit(&rw->state, memory_order_relaxed);
+	}
+}
+
+static inline void futex_rwlock_unlock_shared(futex_rwlock_t *rw) {
+	unsigned int previous = atomic_fetch_sub_explicit(&rw->state, 1, memory_order_release);
+	RW_TRACE_INSTANT("read lock release");
+	// last reader out wakes the waiting writer (and the readers queued behind it)
+	if ((previous & FUTEX_RW_READERS) == 1 && (previous & FUTEX_RW_WAITERS)) {
+		atomic_fetch_and_explicit(&rw->state, ~FUTEX_RW_WAITERS, memory_order_relaxed);
+		futex_rwlock_wake_all(rw);
+	}
+}
+
+static inline void futex_rwlock_lock(futex_rwlock_t *rw) {
+	unsigned int state = atomic_load_explicit(&rw->state, memory_order_relaxed);
+	int contended = 0;
+	while (1) {
+		if (!(state & (FUTEX_RW_READERS | FUTEX_RW_WRITER))) {
+			// take the lock, keep the waiters bit so unlock wakes the others
+			if (atomic_compare_exchange_weak_explicit(&rw->state, &state,
+					(state & FUTEX_RW_WAITERS) | FUTEX_RW_WRITER,
+					memory_order_acquire, memory_order_relaxed)) {
+				if (contended) {
+					RW_TRACE_END("write lock contend");
+				}
+				RW_TRACE_INSTANT("write lock acquire");
+				return;
+			}
+			continue;
+		}
+		if (!contended) {
+			RW_TRACE_BEGIN("write lock contend");
+			contended = 1;
+		}
+		// stop new readers and sleep until the state word changes
+		unsigned int sleep_on = futex_rwlock_announce(rw, state, FUTEX_RW_WRITER_PENDING);
+		if (sleep_on) {
+			futex_rwlock_wait(rw, sleep_on);
+		}
+		state = atomic_load_explicit(&rw->state, memory_order_relaxed);
+	}
+}
+
+static inline void futex_rwlock_unlock(futex_rwlock_t *rw) {
+	// no reader can be inside, clear everything and wake if anyone sleeps
+	unsigned int previous = atomic_exchange_explicit(&rw->state, 0, memory_order_release);
+	RW_TRACE_INSTANT("write lock release");
+	if (previous & FUTEX_RW_WAITERS) {
+		futex_rwlock_wake_all(rw);
+	}
+}
+
+# endif
@@ -0,0 +1,111 @@
+/*
+ *  Read-copy-update with epoch based reclamation, for read mostly data
+ *  published through a pointer (configuration like state).
+ *
+ *  Readers run between rcu_read_lock and rcu_read_unlock and read the data
+ *  through rcu_dereference. Entering and leaving a read section is one store
+ *  each into the reader's own cache line padded slot, no lock, no loop, no
+ *  matter what writers are doing, so readers are wait free.
+ *
+ *  A writer never changes data readers can see: it makes a new copy, publishes
+ *  it with rcu_assign_pointer and calls synchronize_rcu, which starts a new
+ *  epoch and waits until every reader that entered before it has left. After
+ *  that no reader can still hold the old copy and the writer frees it.
+ *
+ *  Every thread that reads must call rcu_register_thread first and
+ *  rcu_unregister_thread before it exits. Read sections must not nest.
+ *
+ *  Include this header and compile with -lpthread (C11 for stdatomic.h)
+ */
+
+# ifndef RCU_H
+# define RCU_H
+
+# include <sched.h>
+# include <stdatomic.h>
+
+# define RCU_MAX_THREADS 128
+# define RCU_CACHE_LINE 64
+
+// epoch the reader entered its read section in, 0 while outside
+typedef struct {
+	atomic_ulong epoch;
+	atomic_int in_use;
+	char pad[RCU_CACHE_LINE - sizeof(atomic_ulong) - sizeof(atomic_int)];
+} __attribute__((aligned(RCU_CACHE_LINE))) rcu_reader_t;
+
+typedef struct {
+	rcu_reader_t readers[RCU_MAX_THREADS];
+	// current epoch, starts at 1 so 0 can mean outside a read section
+	atomic_ulong epoch __attribute__((aligned(RCU_CACHE_LINE)));
+} rcu_domain_t;
+
+// slot of the calling thread in the domain it registered with
+static __thread rcu_reader_t *rcu_thread_reader;
+
+// read a pointer published by rcu_assign_pointer, inside a read section
+# define rcu_dereference(pointer) atomic_load_explicit(&(pointer), memory_order_acquire)
+
+// publish a fully initialized copy, readers see either the old or the new one
+# define rcu_assign_pointer(pointer, value) atomic_store_explicit(&(pointer), (value), memory_order_release)
+
+static inline void rcu_init(rcu_domain_t *rcu) {
+	int i;
+	for (i = 0; i < RCU_MAX_THREADS; ++i) {
+		atomic_init(&rcu->readers[i].epoch, 0);
+		atomic_init(&rcu->readers[i].in_use, 0);
+	}
+	atomic_init(&rcu->epoch, 1);
+}
+
+// claim a free reader slot for the calling thread, return 0 if all are taken
+static inline int rcu_register_thread(rcu_domain_t *rcu) {
+	int i;
+	for (i = 0; i < RCU_MAX_THREADS; ++i) {
+		int expected = 0;
+		if (atomic_compare_exchange_strong(&rcu->readers[i].in_use, &expected, 1)) {
+			rcu_thread_reader = &rcu->readers[i];
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static inline void rcu_unregister_thread(rcu_domain_t *rcu) {
+	(void)rcu;
+	atomic_store(&rcu_thread_reader->in_use, 0);
+	rcu_thread_reader = NULL;
+}
+
+static inline void rcu_read_lock(rcu_domain_t *rcu) {
+	atomic_store(&rcu_thread_reader->epoch, atomic_load(&rcu->epoch));
+	// store of the epoch before any load of the data, pairs with the fence
+	// in synchronize_rcu: either it sees this epoch or this reader sees every
+	// pointer published before it, whatever the hardware reorders
+	atomic_thread_fence(memory_order_seq_cst);
+}
+
+static inline void rcu_read_unlock(rcu_domain_t *rcu) {
+	(void)rcu;
+	atomic_store_explicit(&rcu_thread_reader->epoch, 0, memory_order_release);
+}
+
+// wait until every read section that started before this call has ended
+static inline void synchronize_rcu(rcu_domain_t *rcu) {
+	int i;
+	unsigned long now;
+	// publication of the new pointer before any load of a reader's epoch,
+	// pairs with the fence in rcu_read_lock
+	atomic_thread_fence(memory_order_seq_cst);
+	now = atomic_fetch_add(&rcu->epoch, 1) + 1;
+	atomic_thread_fence(memory_order_seq_cst);
+	for (i = 0; i < RCU_MAX_THREADS; ++i) {
+		unsigned long entered;
+		// readers that entered in the new epoch may only see the new pointer
+		while ((entered = atomic_load(&rcu->readers[i].epoch)) != 0 && entered < now) {
+			sched_yield();
+		}
+	}
+}
+
+# endif
@@ -0,0 +1,286 @@
+/*
+ *  Reusable reader-writer lock built on a mutex and two conditional variables.
+ *
+ *  rwlock_lock_shared / rwlock_unlock_shared - enter / leave as a reader
+ *  rwlock_lock / rwlock_unlock               - enter / leave as the writer
+ *  rwlock_lock_upgradable / rwlock_unlock_upgradable
+ *                                            - enter / leave as the upgrader, a
+ *                                              reader that may become the writer
+ *  rwlock_upgrade                            - upgrader becomes the writer
+ *  rwlock_downgrade                          - writer becomes a reader
+ *
+ *  The policy given to rwlock_init decides who goes first when both
+ *  readers and writers are waiting:
+ *
+ *  RWLOCK_PREFER_READER - a new reader enters whenever no writer is inside,
+ *                         same as the mutex/semaphore program, a steady
+ *                         stream of readers starves the writers.
+ *  RWLOCK_PREFER_WRITER - a new reader waits while any writer is waiting,
+ *                         writers never starve but readers can.
+ *  RWLOCK_PHASE_FAIR    - read and write phases alternate, a writer waits
+ *                         at most for the readers already inside and a
+ *                         reader waits at most for one writer, so neither
+ *                         side starves and waiting time is bounded.
+ *
+ *  Read-modify-write code that only sometimes writes takes the lock
+ *  upgradable instead of exclusive. Only one upgrader is in at a time but
+ *  it shares the lock with the readers, once it decides to write it calls
+ *  rwlock_upgrade, which waits for the other readers to leave and makes
+ *  it the writer without letting any other writer in between, so what it
+ *  read is still valid. rwlock_downgrade turns the writer into a reader
+ *  without releasing, readers waiting get in and no writer can change
+ *  what it just wrote in the meantime. Both are left with the unlock that
+ *  matches the new mode. Under RWLOCK_PREFER_READER a steady stream of
+ *  readers can delay an upgrade like it delays any writer.
+ *
+ *  With -DRW_TRACE (see trace.h) every acquire and release is a point event
+ *  on the thread's timeline and a contended acquire is a span, with the
+ *  sleeps on the conditional variables nested inside.
+ *
+ *  Include this header and compile with -lpthread
+ */
+
+# ifndef RWLOCK_H
+# define RWLOCK_H
+
+# include <pthread.h>
+# include "trace.h"
+
+enum rwlock_policy {
+	RWLOCK_PREFER_READER,
+	RWLOCK_PREFER_WRITER,
+	RWLOCK_PHASE_FAIR
+};
+
+typedef struct {
+	pthread_mutex_t mutex;
+	// readers and writers sleep on their own conditional variable so
+	// that waking one side never wakes the other
+	pthread_cond_t readers_cond;
+	pthread_cond_t writers_cond;
+	// the upgrader sleeps here until it is the last reader
+	pthread_cond_t upgrade_cond;
+	enum rwlock_policy policy;
+	// no. of readers inside the critical section
+	int readers;
+	// 1 if a writer is inside the critical section
+	int writer;
+	int waiting_readers;
+	int waiting_writers;
+	// 1 while an upgrader is inside (counted in readers too) and while it
+	// waits in rwlock_upgrade
+	int upgrader;
+	int upgrading;
+	// phase fair only: incremented by every writer that hands the lock to
+	// waiting readers, those readers are counted in admitted_readers and
+	// no writer may enter until all of them are inside
+	unsigned int phase;
+	int admitted_readers;
+} rwlock_t;
+
+static inline void rwlock_init(rwlock_t *rw, enum rwlock_policy policy) {
+	pthread_mutex_init(&rw->mutex, NULL);
+	pthread_cond_init(&rw->readers_cond, NULL);
+	pthread_cond_init(&rw->writers_cond, NULL);
+	pthread_cond_init(&rw->upgrade_cond, NULL);
+	rw->policy = policy;
+	rw->readers = 0;
+	rw->writer = 0;
+	rw->waiting_readers = 0;
+	rw->waiting_writers = 0;
+	rw->upgrader = 0;
+	rw->upgrading = 0;
+	rw->phase = 0;
+	rw->admitted_readers = 0;
+}
+
+static inline void rwlock_destroy(rwlock_t *rw) {
+	pthread_cond_destroy(&rw->upgrade_cond);
+	pthread_cond_destroy(&rw->writers_cond);
+	pthread_cond_destroy(&rw->readers_cond);
+	pthread_mutex_destroy(&rw->mutex);
+}
+
+// return 1 if a reader which started waiting in my_phase may enter now
+static inline int rwlock_reader_may_enter(rwlock_t *rw, unsigned int my_phase) {
+	if (rw->writer) {
+		return 0;
+	}
+	switch (rw->policy) {
+	case RWLOCK_PREFER_WRITER:
+		return rw->waiting_writers == 0;
+	case RWLOCK_PHASE_FAIR:
+		// readers queued behind a writer go in once that writer finished
+		return rw->waiting_writers == 0 || rw->phase != my_phase;
+	default:
+		return 1;
+	}
+}
+
+static inline void rwlock_lock_shared(rwlock_t *rw) {
+	pthread_mutex_lock(&rw->mutex);
+	unsigned int my_phase = rw->phase;
+	if (!rwlock_reader_may_enter(rw, my_phase)) {
+		RW_TRACE_BEGIN("read lock contend");
+		rw->waiting_readers = rw->waiting_readers + 1;
+		while (!rwlock_reader_may_enter(rw, my_phase)) {
+			RW_TRACE_BEGIN("read lock sleep");
+			pthread_cond_wait(&rw->readers_cond, &rw->mutex);
+			RW_TRACE_END("read lock sleep");
+		}
+		rw->waiting_readers = rw->waiting_readers - 1;
+		// this reader was handed the lock by a finishing writer
+		if (rw->phase != my_phase) {
+			rw->admitted_readers = rw->admitted_readers - 1;
+		}
+		RW_TRACE_END("read lock contend");
+	}
+	rw->readers = rw->readers + 1;
+	RW_TRACE_INSTANT("read lock acquire");
+	pthread_mutex_unlock(&rw->mutex);
+}
+
+// called with the mutex held by every reader or upgrader leaving
+static inline void rwlock_reader_leave(rwlock_t *rw) {
+	rw->readers = rw->readers - 1;
+	// last reader out lets one waiting writer in, the last one besides
+	// the upgrader lets the upgrade go on
+	if (rw->readers == 0 && rw->waiting_writers > 0) {
+		pthread_cond_signal(&rw->writers_cond);
+	} else if (rw->readers == 1 && rw->upgrading) {
+		pthread_cond_signal(&rw->upgrade_cond);
+	}
+}
+
+static inline void rwlock_unlock_shared(rwlock_t *rw) {
+	pthread_mutex_lock(&rw->mutex);
+	rwlock_reader_leave(rw);
+	RW_TRACE_INSTANT("read lock release");
+	pthread_mutex_unlock(&rw->mutex);
+}
+
+static inline void rwlock_lock(rwlock_t *rw) {
+	pthread_mutex_lock(&rw->mutex);
+	rw->waiting_writers = rw->waiting_writers + 1;
+	if (rw->writer || rw->readers > 0 || rw->admitted_readers > 0) {
+		RW_TRACE_BEGIN("write lock contend");
+		while (rw->writer || rw->readers > 0 || rw->admitted_readers > 0) {
+			RW_TRACE_BEGIN("write lock sleep");
+			pthread_cond_wait(&rw->writers_cond, &rw->mutex);
+			RW_TRACE_END("write lock sleep");
+		}
+		RW_TRACE_END("write lock contend");
+	}
+	rw->waiting_writers = rw->waiting_writers - 1;
+	rw->writer = 1;
+	RW_TRACE_INSTANT("write lock acquire");
+	pthread_mutex_unlock(&rw->mutex);
+}
+
+// called with the mutex held once the writer is out, lets the next ones in
+static inline void rwlock_writer_leave(rwlock_t *rw) {
+	rw->writer = 0;
+	switch (rw->policy) {
+	case RWLOCK_PREFER_WRITER:
+		// hand over to the next writer, readers only when none is waiting
+		if (rw->waiting_writers > 0) {
+			pthread_cond_signal(&rw->writers_cond);
+		} else {
+			pthread_cond_broadcast(&rw->readers_cond);
+		}
+		break;
+	case RWLOCK_PHASE_FAIR:
+		// start a read phase for every reader that queued behind us,
+		// the next writer goes after them
+		if (rw->waiting_readers > 0) {
+			rw->phase = rw->phase + 1;
+			rw->admitted_readers = rw->waiting_readers;
+			pthread_cond_broadcast(&rw->readers_cond);
+		} else {
+			pthread_cond_signal(&rw->writers_cond);
+		}
+		break;
+	default:
+		pthread_cond_broadcast(&rw->readers_cond);
+		pthread_cond_signal(&rw->writers_cond);
+		break;
+	}
+}
+
+static inline void rwlock_unlock(rwlock_t *rw) {
+	pthread_mutex_lock(&rw->mutex);
+	rwlock_writer_leave(rw);
+	RW_TRACE_INSTANT("write lock release");
+	pthread_mutex_unlock(&rw->mutex);
+}
+
+// enter as a reader, but wait while another upgrader is inside too.
+// Waits like a reader so the policy treats it as one
+static inline void rwlock_lock_upgradable(rwlock_t *rw) {
+	pthread_mutex_lock(&rw->mutex);
+	unsigned int my_phase = rw->phase;
+	if (!rwlock_reader_may_enter(rw, my_phase) || rw->upgrader) {
+		RW_TRACE_BEGIN("upgradable lock contend");
+		rw->waiting_readers = rw->waiting_readers + 1;
+		while (!rwlock_reader_may_enter(rw, my_phase) || rw->upgrader) {
+			RW_TRACE_BEGIN("read lock sleep");
+			pthread_cond_wait(&rw->readers_cond, &rw->mutex);
+			RW_TRACE_END("read lock sleep");
+		}
+		rw->waiting_readers = rw->waiting_readers - 1;
+		if (rw->phase != my_phase) {
+			rw->admitted_readers = rw->admitted_readers - 1;
+		}
+		RW_TRACE_END("upgradable lock contend");
+	}
+	rw->upgrader = 1;
+	rw->readers = rw->readers + 1;
+	RW_TRACE_INSTANT("upgradable lock acquire");
+	pthread_mutex_unlock(&rw->mutex);
+}
+
+static inline void rwlock_unlock_upgradable(rwlock_t *rw) {
+	pthread_mutex_lock(&rw->mutex);
+	rw->upgrader = 0;
+	rwlock_reader_leave(rw);
+	// the next upgrader waits with the readers
+	if (rw->waiting_readers > 0) {
+		pthread_cond_broadcast(&rw->readers_cond);
+	}
+	RW_TRACE_INSTANT("upgradable lock release");
+	pthread_mutex_unlock(&rw->mutex);
+}
+
+// upgrader becomes the writer once the other readers left, leave with rwlock_unlock.
+// Counts as a waiting writer meanwhile so the policy holds back new readers,
+// a writer already waiting stays behind since the upgrader is still a reader
+static inline void rwlock_upgrade(rwlock_t *rw) {
+	pthread_mutex_lock(&rw->mutex);
+	rw->upgrading = 1;
+	rw->waiting_writers = rw->waiting_writers + 1;
+	while (rw->readers > 1) {
+		RW_TRACE_BEGIN("upgrade sleep");
+		pthread_cond_wait(&rw->upgrade_cond, &rw->mutex);
+		RW_TRACE_END("upgrade sleep");
+	}
+	rw->waiting_writers = rw->waiting_writers - 1;
+	rw->upgrading = 0;
+	rw->upgrader = 0;
+	rw->readers = 0;
+	rw->writer = 1;
+	RW_TRACE_INSTANT("upgrade");
+	pthread_mutex_unlock(&rw->mutex);
+}
+
+// writer becomes a reader without releasing, leave with rwlock_unlock_shared.
+// Waiting readers are let in as if the writer left, waiting writers find a
+// reader inside and keep waiting
+static inline void rwlock_downgrade(rwlock_t *rw) {
+	pthread_mutex_lock(&rw->mutex);
+	rw->readers = 1;
+	rwlock_writer_leave(rw);
+	RW_TRACE_INSTANT("downgrade");
+	pthread_mutex_unlock(&rw->mutex);
+}
+
+# endif
@@ -0,0 +1,750 @@
+/*
+ *  Benchmark and stress test of the reader-writer lock implementations.
+ *
+ *  Every variant protects the same shared data, two counters a writer always
+ *  keeps equal. For every variant the benchmark sweeps
+ *
+ *    thread count         1, 2, 4 ... max threads
+ *    read:write ratio     99:1, 90:10, 50:50
+ *    critical section     0, 100 and 1000 iterations of busy work
+ *
+ *  and runs the threads for a fixed time, each one choosing read or write at
+ *  random by the ratio for every operation. Reported per run:
+ *
+ *    ops/sec              total operations per second
+ *    p50 / p99 / p999     latency in nano seconds from calling lock until
+ *                         inside the critical section, all operations
+ *    w-p99                the same p99 for writes only
+ *    fairness             fewest / most operations done by one thread
+ *    check                ok if no reader ever saw the two counters differ
+ *                         and the counter equals the no. of writes, which
+ *                         fails if two writers or a reader and a writer
+ *                         were ever inside at the same time
+ *
+ *  Variants:
+ *  mutex_semaphore   - the algorithm of Implementing_reader-writer_locks_using_mutex_semaphore.c
+ *  cond_variable     - the algorithm of Implementing_reader-writer_locks_using_cond_variable.c
+ *  rwlock_reader     - rwlock.h with RWLOCK_PREFER_READER
+ *  rwlock_writer     - rwlock.h with RWLOCK_PREFER_WRITER
+ *  rwlock_phase_fair - rwlock.h with RWLOCK_PHASE_FAIR
+ *  brlock            - brlock.h, per thread reader counters
+ *  seqlock           - seqlock.h, readers take no lock
+ *  futex             - futex_rwlock.h, one atomic state word
+ *  adaptive          - adaptive_lock.h, futex lock that spins before it parks
+ *  rcu               - rcu.h, writers publish a new copy
+ *  cohort            - cohort_lock.h, NUMA node locks handing over in batches
+ *  map_uniform       - striped_map.h, 64 stripes, keys drawn uniformly from 4096
+ *  map_hot           - striped_map.h, the same but 90% of operations on one key
+ *
+ *  For seqlock and rcu readers there is no lock to acquire, their latency is
+ *  the time until a consistent copy was read. The map variants lock inside
+ *  the map, their latency is that of the whole get or add and there is no
+ *  busy work, readers get a random key and writers add 1 to one, the check
+ *  compares the sum of all values with the no. of writes.
+ *
+ *  To compile this program run below cmd
+ *  gcc -O2 rwlock_benchmark.c -lpthread -o rwlock_benchmark
+ *
+ *  Add -DRW_TRACE to record every operation and lock wait of every run into
+ *  trace_<variant>_<threads>_<write percent>_<cs>.json (see trace.h),
+ *  best together with a variant and a small no. of threads
+ *
+ *  To run this program run below cmd
+ *  ./rwlock_benchmark [milliseconds per run] [max threads] [variant]
+ */
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <pthread.h>
+# include <semaphore.h>
+# include <stdatomic.h>
+# include "rwlock.h"
+# include "brlock.h"
+# include "seqlock.h"
+# include "futex_rwlock.h"
+# include "adaptive_lock.h"
+# include "rcu.h"
+# include "cohort_lock.h"
+# include "striped_map.h"
+# include "trace.h"
+
+// shared data, a writer increments both, a reader that sees them differ
+// overlapped a writer. Relaxed atomics so the seqlock readers may read
+// them while a writer changes them
+atomic_int shared_data;
+atomic_int shared_copy;
+
+// ---------- per thread measurements ----------
+
+// latency histogram, 8 linear buckets per power of 2
+# define HISTOGRAM_BUCKETS (41 * 8)
+
+typedef struct {
+	long long reads;
+	long long writes;
+	long long torn;
+	unsigned int latency[HISTOGRAM_BUCKETS];
+	unsigned int write_latency[HISTOGRAM_BUCKETS];
+	unsigned int seed;
+	unsigned long long started;
+} worker_t;
+
+// measurements of the calling thread
+__thread worker_t *me;
+
+// busy work iterations inside every critical section
+int critical_section_length;
+
+static inline unsigned long long now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline int histogram_bucket(unsigned long long ns) {
+	if (ns < 8) {
+		return ns;
+	}
+	int msb = 63 - __builtin_clzll(ns);
+	int bucket = msb * 8 + ((ns >> (msb - 3)) & 7);
+	return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+// smallest latency in ns of given bucket's range
+static inline unsigned long long bucket_value(int bucket) {
+	if (bucket < 8) {
+		return bucket;
+	}
+	int msb = bucket / 8;
+	return (8ULL + bucket % 8) << (msb - 3);
+}
+
+// called right before taking the lock
+static inline void acquire_started(void) {
+	RW_TRACE_BEGIN("lock wait");
+	me->started = now_ns();
+}
+
+// called as the first thing inside the critical section
+static inline void acquired(int is_write) {
+	RW_TRACE_END("lock wait");
+	int bucket = histogram_bucket(now_ns() - me->started);
+	me->latency[bucket]++;
+	if (is_write) {
+		me->write_latency[bucket]++;
+	}
+}
+
+static inline void busy_work(void) {
+	int i;
+	for (i = 0; i < critical_section_length; ++i) {
+		__asm__ __volatile__("" ::: "memory");
+	}
+}
+
+// reader critical section, return 1 if both counters were equal
+static inline int read_section(void) {
+	int a = atomic_load_explicit(&shared_data, memory_order_relaxed);
+	busy_work();
+	int b = atomic_load_explicit(&shared_copy, memory_order_relaxed);
+	return a == b;
+}
+
+// writer critical section, read-modify-write with busy work in the middle
+// so overlapping writers lose increments
+static inline void write_section(void) {
+	int value = atomic_load_explicit(&shared_data, memory_order_relaxed);
+	atomic_store_explicit(&shared_data, value + 1, memory_order_relaxed);
+	busy_work();
+	atomic_store_explicit(&shared_copy, value + 1, memory_order_relaxed);
+}
+
+// ---------- mutex and semaphore variant ----------
+
+pthread_mutex_t sem_variant_lock = PTHREAD_MUTEX_INITIALIZER;
+sem_t sem_variant_sem;
+int sem_variant_reader_count;
+
+void sem_variant_init(void) {
+	sem_init(&sem_variant_sem, 0, 1);
+	sem_variant_reader_count = 0;
+}
+
+void sem_variant_destroy(void) {
+	sem_destroy(&sem_variant_sem);
+}
+
+int sem_variant_read(void) {
+	acquire_started();
+	pthread_mutex_lock(&sem_variant_lock);
+	sem_variant_reader_count = sem_variant_reader_count + 1;
+	if (sem_variant_reader_count == 1) {
+		sem_wait(&sem_variant_sem);
+	}
+	pthread_mutex_unlock(&sem_variant_lock);
+	acquired(0);
+
+	int consistent = read_section();
+
+	pthread_mutex_lock(&sem_variant_lock);
+	sem_variant_reader_count = sem_variant_reader_count - 1;
+	if (sem_variant_reader_count == 0) {
+		sem_post(&sem_variant_sem);
+	}
+	pthread_mutex_unlock(&sem_variant_lock);
+	return consistent;
+}
+
+void sem_variant_write(void) {
+	acquire_started();
+	sem_wait(&sem_variant_sem);
+	acquired(1);
+	write_section();
+	sem_post(&sem_variant_sem);
+}
+
+// ---------- mutex and conditional variable variant ----------
+
+pthread_mutex_t cond_variant_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cond_variant_cond = PTHREAD_COND_INITIALIZER;
+int cond_variant_reader_count, cond_variant_writer_count;
+
+void cond_variant_init(void) {
+	cond_variant_reader_count = 0;
+	cond_variant_writer_count = 0;
+}
+
+void cond_variant_destroy(void) {
+}
+
+int cond_variant_read(void) {
+	acquire_started();
+	pthread_mutex_lock(&cond_variant_lock);
+	while (cond_variant_writer_count == 1) {
+		pthread_cond_wait(&cond_variant_cond, &cond_variant_lock);
+	}
+	cond_variant_reader_count = cond_variant_reader_count + 1;
+	pthread_mutex_unlock(&cond_variant_lock);
+	acquired(0);
+
+	int consistent = read_section();
+
+	pthread_mutex_lock(&cond_variant_lock);
+	cond_variant_reader_count = cond_variant_reader_count - 1;
+	if (cond_variant_reader_count == 0) {
+		pthread_cond_broadcast(&cond_variant_cond);
+	}
+	pthread_mutex_unlock(&cond_variant_lock);
+	return consistent;
+}
+
+void cond_variant_write(void) {
+	acquire_started();
+	pthread_mutex_lock(&cond_variant_lock);
+	while (cond_variant_reader_count > 0 || cond_variant_writer_count == 1) {
+		pthread_cond_wait(&cond_variant_cond, &cond_variant_lock);
+	}
+	cond_variant_writer_count = 1;
+	pthread_mutex_unlock(&cond_variant_lock);
+	acquired(1);
+
+	write_section();
+
+	pthread_mutex_lock(&cond_variant_lock);
+	cond_variant_writer_count = 0;
+	pthread_cond_broadcast(&cond_variant_cond);
+	pthread_mutex_unlock(&cond_variant_lock);
+}
+
+// ---------- rwlock.h variants, one per policy ----------
+
+rwlock_t rwlock_variant_lock;
+
+void rwlock_reader_variant_init(void) {
+	rwlock_init(&rwlock_variant_lock, RWLOCK_PREFER_READER);
+}
+
+void rwlock_writer_variant_init(void) {
+	rwlock_init(&rwlock_variant_lock, RWLOCK_PREFER_WRITER);
+}
+
+void rwlock_phase_fair_variant_init(void) {
+	rwlock_init(&rwlock_variant_lock, RWLOCK_PHASE_FAIR);
+}
+
+void rwlock_variant_destroy(void) {
+	rwlock_destroy(&rwlock_variant_lock);
+}
+
+int rwlock_variant_read(void) {
+	acquire_started();
+	rwlock_lock_shared(&rwlock_variant_lock);
+	acquired(0);
+	int consistent = read_section();
+	rwlock_unlock_shared(&rwlock_variant_lock);
+	return consistent;
+}
+
+void rwlock_variant_write(void) {
+	acquire_started();
+	rwlock_lock(&rwlock_variant_lock);
+	acquired(1);
+	write_section();
+	rwlock_unlock(&rwlock_variant_lock);
+}
+
+// ---------- big-reader lock variant ----------
+
+brlock_t br_variant_lock;
+
+void br_variant_init(void) {
+	brlock_init(&br_variant_lock);
+}
+
+void br_variant_destroy(void) {
+	brlock_destroy(&br_variant_lock);
+}
+
+int br_variant_read(void) {
+	acquire_started();
+	brlock_lock_shared(&br_variant_lock);
+	acquired(0);
+	int consistent = read_section();
+	brlock_unlock_shared(&br_variant_lock);
+	return consistent;
+}
+
+void br_variant_write(void) {
+	acquire_started();
+	brlock_lock(&br_variant_lock);
+	acquired(1);
+	write_section();
+	brlock_unlock(&br_variant_lock);
+}
+
+// ---------- seqlock variant ----------
+
+seqlock_t seq_variant_lock;
+
+void seq_variant_init(void) {
+	seqlock_init(&seq_variant_lock);
+}
+
+void seq_variant_destroy(void) {
+	seqlock_destroy(&seq_variant_lock);
+}
+
+int seq_variant_read(void) {
+	unsigned int start;
+	int consistent;
+	acquire_started();
+	do {
+		start = seqlock_read_begin(&seq_variant_lock);
+		consistent = read_section();
+	} while (seqlock_read_retry(&seq_variant_lock, start));
+	acquired(0);
+	return consistent;
+}
+
+void seq_variant_write(void) {
+	acquire_started();
+	seqlock_write_lock(&seq_variant_lock);
+	acquired(1);
+	write_section();
+	seqlock_write_unlock(&seq_variant_lock);
+}
+
+// ---------- futex variant ----------
+
+futex_rwlock_t futex_variant_lock;
+
+void futex_variant_init(void) {
+	futex_rwlock_init(&futex_variant_lock);
+}
+
+void futex_variant_destroy(void) {
+}
+
+int futex_variant_read(void) {
+	acquire_started();
+	futex_rwlock_lock_shared(&futex_variant_lock);
+	acquired(0);
+	int consistent = read_section();
+	futex_rwlock_unlock_shared(&futex_variant_lock);
+	return consistent;
+}
+
+void futex_variant_write(void) {
+	acquire_started();
+	futex_rwlock_lock(&futex_variant_lock);
+	acquired(1);
+	write_section();
+	futex_rwlock_unlock(&futex_variant_lock);
+}
+
+// ---------- adaptive spin then park variant ----------
+
+adaptive_rwlock_t adaptive_variant_lock;
+
+void adaptive_variant_init(void) {
+	adaptive_rwlock_init(&adaptive_variant_lock);
+}
+
+void adaptive_variant_destroy(void) {
+}
+
+int adaptive_variant_read(void) {
+	acquire_started();
+	adaptive_rwlock_lock_shared(&adaptive_variant_lock);
+	acquired(0);
+	int consistent = read_section();
+	adaptive_rwlock_unlock_shared(&adaptive_variant_lock);
+	return consistent;
+}
+
+void adaptive_variant_write(void) {
+	acquire_started();
+	adaptive_rwlock_lock(&adaptive_variant_lock);
+	acquired(1);
+	write_section();
+	adaptive_rwlock_unlock(&adaptive_variant_lock);
+}
+
+// ---------- read-copy-update variant ----------
+
+// copy of the shared data published through rcu_variant_state
+struct rcu_variant_copy {
+	int data;
+	int copy;
+};
+
+rcu_domain_t rcu_variant_domain;
+_Atomic(struct rcu_variant_copy *) rcu_variant_state;
+pthread_mutex_t rcu_variant_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void rcu_variant_init(void) {
+	struct rcu_variant_copy *initial = malloc(sizeof(*initial));
+	initial->data = 0;
+	initial->copy = 0;
+	rcu_init(&rcu_variant_domain);
+	rcu_assign_pointer(rcu_variant_state, initial);
+}
+
+void rcu_variant_destroy(void) {
+	free(atomic_load(&rcu_variant_state));
+}
+
+int rcu_variant_read(void) {
+	// readers register once per thread and free the slot when the worker exits,
+	// main keeps the thread count within the slots so running out is a bug
+	if (rcu_thread_reader == NULL && !rcu_register_thread(&rcu_variant_domain)) {
+		fprintf(stderr, "rcu: no free reader slot, at most %d threads\n", RCU_MAX_THREADS);
+		exit(1);
+	}
+	acquire_started();
+	rcu_read_lock(&rcu_variant_domain);
+	struct rcu_variant_copy *state = rcu_dereference(rcu_variant_state);
+	int data = state->data;
+	busy_work();
+	int consistent = data == state->copy;
+	rcu_read_unlock(&rcu_variant_domain);
+	acquired(0);
+	return consistent;
+}
+
+void rcu_variant_write(void) {
+	acquire_started();
+	pthread_mutex_lock(&rcu_variant_writer_lock);
+	acquired(1);
+	struct rcu_variant_copy *old_state = atomic_load(&rcu_variant_state);
+	struct rcu_variant_copy *new_state = malloc(sizeof(*new_state));
+	new_state->data = old_state->data + 1;
+	busy_work();
+	new_state->copy = old_state->copy + 1;
+	rcu_assign_pointer(rcu_variant_state, new_state);
+	pthread_mutex_unlock(&rcu_variant_writer_lock);
+
+	synchronize_rcu(&rcu_variant_domain);
+	free(old_state);
+}
+
+int rcu_variant_value(void) {
+	return atomic_load(&rcu_variant_state)->data;
+}
+
+// ---------- NUMA-aware cohort variant ----------
+
+cohort_rwlock_t cohort_variant_lock;
+
+void cohort_variant_init(void) {
+	cohort_rwlock_init(&cohort_variant_lock);
+}
+
+void cohort_variant_destroy(void) {
+	cohort_rwlock_destroy(&cohort_variant_lock);
+}
+
+int cohort_variant_read(void) {
+	acquire_started();
+	cohort_rwlock_lock_shared(&cohort_variant_lock);
+	acquired(0);
+	int consistent = read_section();
+	cohort_rwlock_unlock_shared(&cohort_variant_lock);
+	return consistent;
+}
+
+void cohort_variant_write(void) {
+	acquire_started();
+	cohort_rwlock_lock(&cohort_variant_lock);
+	acquired(1);
+	write_section();
+	cohort_rwlock_unlock(&cohort_variant_lock);
+}
+
+// ---------- striped hash map variants ----------
+
+# define MAP_VARIANT_KEYS 4096
+# define MAP_VARIANT_STRIPES 64
+
+striped_map_t map_variant;
+// percentage of operations on key 0
+int map_variant_hot_percent;
+
+void map_uniform_variant_init(void) {
+	striped_map_init(&map_variant, MAP_VARIANT_STRIPES);
+	map_variant_hot_percent = 0;
+}
+
+void map_hot_variant_init(void) {
+	striped_map_init(&map_variant, MAP_VARIANT_STRIPES);
+	map_variant_hot_percent = 90;
+}
+
+void map_variant_destroy(void) {
+	striped_map_destroy(&map_variant);
+}
+
+// key of the next operation, from the bits of the worker's random no.
+// not used to choose between read and write
+int map_variant_key(void) {
+	unsigned int random = me->seed >> 8;
+	if ((int)(random % 100) < map_variant_hot_percent) {
+		return 0;
+	}
+	return (random / 100) % MAP_VARIANT_KEYS;
+}
+
+int map_variant_read(void) {
+	int value;
+	acquire_started();
+	striped_map_get(&map_variant, map_variant_key(), &value);
+	acquired(0);
+	return 1;
+}
+
+void map_variant_write(void) {
+	int value;
+	acquire_started();
+	striped_map_add(&map_variant, map_variant_key(), 1, &value);
+	acquired(1);
+}
+
+void map_variant_sum(int key, int value, void *sum) {
+	(void)key;
+	*(int *)sum = *(int *)sum + value;
+}
+
+int map_variant_value(void) {
+	int sum = 0;
+	striped_map_for_each(&map_variant, map_variant_sum, &sum);
+	return sum;
+}
+
+// ---------- benchmark ----------
+
+typedef struct {
+	const char *name;
+	void (*init)(void);
+	void (*destroy)(void);
+	int (*read)(void);
+	void (*write)(void);
+	// no. of writes the protected data shows, NULL for shared_data
+	int (*value)(void);
+} variant_t;
+
+variant_t variants[] = {
+	{ "mutex_semaphore", sem_variant_init, sem_variant_destroy, sem_variant_read, sem_variant_write, NULL },
+	{ "cond_variable", cond_variant_init, cond_variant_destroy, cond_variant_read, cond_variant_write, NULL },
+	{ "rwlock_reader", rwlock_reader_variant_init, rwlock_variant_destroy, rwlock_variant_read, rwlock_variant_write, NULL },
+	{ "rwlock_writer", rwlock_writer_variant_init, rwlock_variant_destroy, rwlock_variant_read, rwlock_variant_write, NULL },
+	{ "rwlock_phase_fair", rwlock_phase_fair_variant_init, rwlock_variant_destroy, rwlock_variant_read, rwlock_variant_write, NULL },
+	{ "brlock", br_variant_init, br_variant_destroy, br_variant_read, br_variant_write, NULL },
+	{ "seqlock", seq_variant_init, seq_variant_destroy, seq_variant_read, seq_variant_write, NULL },
+	{ "futex", futex_variant_init, futex_variant_destroy, futex_variant_read, futex_variant_write, NULL },
+	{ "adaptive", adaptive_variant_init, adaptive_variant_destroy, adaptive_variant_read, adaptive_variant_write, NULL },
+	{ "rcu", rcu_variant_init, rcu_variant_destroy, rcu_variant_read, rcu_variant_write, rcu_variant_value },
+	{ "cohort", cohort_variant_init, cohort_variant_destroy, cohort_variant_read, cohort_variant_write, NULL },
+	{ "map_uniform", map_uniform_variant_init, map_variant_destroy, map_variant_read, map_variant_write, map_variant_value },
+	{ "map_hot", map_hot_variant_init, map_variant_destroy, map_variant_read, map_variant_write, map_variant_value },
+};
+
+// write percentage of every read:write ratio and busy work of every critical section length
+int write_percents[] = { 1, 10, 50 };
+int critical_section_lengths[] = { 0, 100, 1000 };
+
+// variant under test, write percentage, start barrier and stop flag of the current run
+variant_t *current;
+int write_percent;
+pthread_barrier_t start_barrier;
+atomic_int stop;
+
+void *worker(void *arg) {
+	me = (worker_t *)arg;
+	RW_TRACE_THREAD_START("worker");
+	pthread_barrier_wait(&start_barrier);
+	while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+		// xorshift random no. picks read or write
+		me->seed ^= me->seed << 13;
+		me->seed ^= me->seed >> 17;
+		me->seed ^= me->seed << 5;
+		if ((int)(me->seed % 100) < write_percent) {
+			RW_TRACE_BEGIN("write");
+			current->write();
+			RW_TRACE_END("write");
+			me->writes = me->writes + 1;
+		} else {
+			RW_TRACE_BEGIN("read");
+			if (!current->read()) {
+				me->torn = me->torn + 1;
+			}
+			RW_TRACE_END("read");
+			me->reads = me->reads + 1;
+		}
+	}
+	// free the rcu reader slot, only the rcu variant registers
+	if (rcu_thread_reader != NULL) {
+		rcu_unregister_thread(&rcu_variant_domain);
+	}
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}
+
+// return latency in ns below which given fraction of the samples lie
+unsigned long long percentile(unsigned long long *histogram, unsigned long long total, double fraction) {
+	unsigned long long seen = 0;
+	int bucket;
+	for (bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+		seen = seen + histogram[bucket];
+		if (total > 0 && seen >= fraction * total) {
+			return bucket_value(bucket);
+		}
+	}
+	return 0;
+}
+
+// run one variant with given no. of threads for given time and print one line
+void run(variant_t *variant, int threads, int milliseconds) {
+	pthread_t workerThread[threads];
+	worker_t *workers = calloc(threads, sizeof(worker_t));
+	unsigned long long latency[HISTOGRAM_BUCKETS] = { 0 }, write_latency[HISTOGRAM_BUCKETS] = { 0 };
+	unsigned long long total = 0, write_total = 0;
+	long long ops = 0, writes = 0, torn = 0, fewest = -1, most = 0;
+	struct timespec duration = { milliseconds / 1000, (milliseconds % 1000) * 1000000L };
+	int i, bucket;
+
+	current = variant;
+	current->init();
+	atomic_store(&shared_data, 0);
+	atomic_store(&shared_copy, 0);
+	atomic_store(&stop, 0);
+	pthread_barrier_init(&start_barrier, NULL, threads + 1);
+
+	for (i = 0; i < threads; ++i) {
+		workers[i].seed = 2463534242u + i * 7919;
+		pthread_create(&workerThread[i], NULL, worker, &workers[i]);
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	nanosleep(&duration, NULL);
+	atomic_store(&stop, 1);
+
+	for (i = 0; i < threads; ++i) {
+		pthread_join(workerThread[i], NULL);
+		long long done = workers[i].reads + workers[i].writes;
+		ops = ops + done;
+		writes = writes + workers[i].writes;
+		torn = torn + workers[i].torn;
+		if (fewest < 0 || done < fewest) {
+			fewest = done;
+		}
+		if (done > most) {
+			most = done;
+		}
+		for (bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+			latency[bucket] = latency[bucket] + workers[i].latency[bucket];
+			write_latency[bucket] = write_latency[bucket] + workers[i].write_latency[bucket];
+			total = total + workers[i].latency[bucket];
+			write_total = write_total + workers[i].write_latency[bucket];
+		}
+	}
+
+	int value = variant->value != NULL ? variant->value() : atomic_load(&shared_data);
+	int correct = torn == 0 && value == writes;
+	printf("%-18s %7d %5d:%-3d %5d %14.0f %8llu %8llu %8llu %8llu %9.2f %7s\n",
+		variant->name, threads, 100 - write_percent, write_percent, critical_section_length,
+		ops * 1000.0 / milliseconds,
+		percentile(latency, total, 0.50), percentile(latency, total, 0.99),
+		percentile(latency, total, 0.999), percentile(write_latency, write_total, 0.99),
+		most > 0 ? (double)fewest / most : 0.0, correct ? "ok" : "FAILED");
+	fflush(stdout);
+
+# ifdef RW_TRACE
+	char trace_path[256];
+	snprintf(trace_path, sizeof(trace_path), "trace_%s_%d_%d_%d.json",
+		variant->name, threads, write_percent, critical_section_length);
+	RW_TRACE_DUMP(trace_path);
+# endif
+
+	pthread_barrier_destroy(&start_barrier);
+	current->destroy();
+	free(workers);
+}
+
+int main(int argc, char **argv) {
+	int milliseconds = argc > 1 ? atoi(argv[1]) : 100;
+	int max_threads = argc > 2 ? atoi(argv[2]) : 64;
+	const char *only = argc > 3 ? argv[3] : NULL;
+	int noOfVariants = sizeof(variants) / sizeof(variants[0]);
+	int noOfMixes = sizeof(write_percents) / sizeof(write_percents[0]);
+	int noOfLengths = sizeof(critical_section_lengths) / sizeof(critical_section_lengths[0]);
+	int v, threads, m, c;
+
+	if (max_threads > RCU_MAX_THREADS && (only == NULL || strcmp(only, "rcu") == 0)) {
+		printf("rcu runs are capped at %d threads\n", RCU_MAX_THREADS);
+	}
+	printf("%-18s %7s %9s %5s %14s %8s %8s %8s %8s %9s %7s\n", "variant", "threads", "r:w", "cs",
+		"ops/sec", "p50 ns", "p99 ns", "p999 ns", "w-p99 ns", "fairness", "check");
+
+	for (v = 0; v < noOfVariants; ++v) {
+		if (only != NULL && strcmp(only, variants[v].name) != 0) {
+			continue;
+		}
+		for (c = 0; c < noOfLengths; ++c) {
+			critical_section_length = critical_section_lengths[c];
+			for (m = 0; m < noOfMixes; ++m) {
+				write_percent = write_percents[m];
+				for (threads = 1; threads <= max_threads; threads = threads * 2) {
+					// the rcu domain only has RCU_MAX_THREADS reader slots
+					if (variants[v].read == rcu_variant_read && threads > RCU_MAX_THREADS) {
+						break;
+					}
+					run(&variants[v], threads, milliseconds);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ *  Sequence lock (seqlock) for small shared data that is read far more
+ *  often than it is written.
+ *
+ *  The writer makes the sequence counter odd, updates the data and makes it
+ *  even again. A reader takes no lock at all: it remembers the counter,
+ *  copies the data and checks the counter again, if a write was running or
+ *  happened meanwhile (counter odd or changed) it simply reads again.
+ *  Readers never write shared memory, so they cause no cache line
+ *  invalidations and scale with the no. of cores, writers never wait for
+ *  readers. Only suitable for data a reader can copy and throw away, e.g.
+ *  no pointers that a writer may free.
+ *
+ *  seqlock_read_begin / seqlock_read_retry   - reader side
+ *  seqlock_write_lock / seqlock_write_unlock - writer side
+ *
+ *  Data read inside the read section can change under the reader, access it
+ *  with relaxed atomics so those racy reads are well defined.
+ *
+ *  Include this header and compile with -lpthread (C11 for stdatomic.h)
+ */
+
+# ifndef SEQLOCK_H
+# define SEQLOCK_H
+
+# include <pthread.h>
+# include <sched.h>
+# include <stdatomic.h>
+
+typedef struct {
+	// even - no writer inside, odd - write in progress
+	atomic_uint sequence;
+	// serializes the writers
+	pthread_mutex_t writer_mutex;
+} seqlock_t;
+
+static inline void seqlock_init(seqlock_t *sl) {
+	atomic_init(&sl->sequence, 0);
+	pthread_mutex_init(&sl->writer_mutex, NULL);
+}
+
+static inline void seqlock_destroy(seqlock_t *sl) {
+	pthread_mutex_destroy(&sl->writer_mutex);
+}
+
+// return the even sequence number a read section starts from,
+// waits while a writer is inside
+static inline unsigned int seqlock_read_begin(seqlock_t *sl) {
+	unsigned int start;
+	while ((start = atomic_load_explicit(&sl->sequence, memory_order_acquire)) & 1) {
+		sched_yield();
+	}
+	return start;
+}
+
+// return 1 if a writer ran since seqlock_read_begin, the data read
+// in between may be torn and must be read again
+static inline int seqlock_read_retry(seqlock_t *sl, unsigned int start) {
+	// order the data reads before the second sequence read
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&sl->sequence, memory_order_relaxed) != start;
+}
+
+static inline void seqlock_write_lock(seqlock_t *sl) {
+	pthread_mutex_lock(&sl->writer_mutex);
+	atomic_store_explicit(&sl->sequence,
+		atomic_load_explicit(&sl->sequence, memory_order_relaxed) + 1, memory_order_relaxed);
+	// odd sequence must be visible before any data store
+	atomic_thread_fence(memory_order_release);
+}
+
+static inline void seqlock_write_unlock(seqlock_t *sl) {
+	// data stores must be visible before the even sequence
+	atomic_store_explicit(&sl->sequence,
+		atomic_load_explicit(&sl->sequence, memory_order_relaxed) + 1, memory_order_release);
+	pthread_mutex_unlock(&sl->writer_mutex);
+}
+
+# endif
@@ -0,0 +1,266 @@
+/*
+ *  Concurrent hash map from int keys to int values, split into
+ *  independently locked stripes.
+ *
+ *  The rwlock programs protect a single shared_data with one lock. When
+ *  the shared data is a key-value table that one lock serializes writers
+ *  of unrelated keys and every reader waits for them. Here the keys are
+ *  spread over a power of 2 no. of stripes by the high bits of their
+ *  hash, and every stripe is a small open addressing table of its own,
+ *  guarded by its own futex reader-writer lock (futex_rwlock.h) and
+ *  padded to its own cache lines:
+ *
+ *  - operations on keys of different stripes never touch the same lock
+ *    or cache line, so throughput grows with the no. of threads for
+ *    uniform keys
+ *  - a hot key only blocks its own stripe, readers of that stripe still
+ *    share it while no writer is inside
+ *  - a stripe that gets too full doubles its own table under its own
+ *    write lock, the other stripes keep working, so the table never stops
+ *    as a whole to grow
+ *
+ *  Inside a stripe keys are placed by linear probing on the low bits of
+ *  the hash and removed with backward shift, so there are no tombstones.
+ *  striped_map_size adds up the stripes one after another and is only a
+ *  snapshot while no thread writes.
+ *
+ *  Include this header and compile with -lpthread (C11 for stdatomic.h)
+ */
+
+# ifndef STRIPED_MAP_H
+# define STRIPED_MAP_H
+
+# include <stdlib.h>
+# include "futex_rwlock.h"
+
+# define STRIPED_MAP_CACHE_LINE 64
+// initial no. of slots of every stripe, a power of 2
+# define STRIPED_MAP_STRIPE_SLOTS 16
+
+typedef struct {
+	int key;
+	int value;
+	int used;
+} striped_map_entry_t;
+
+typedef struct {
+	futex_rwlock_t lock;
+	striped_map_entry_t *entries;
+	// no. of slots (a power of 2) and used slots
+	unsigned int capacity;
+	unsigned int count;
+} __attribute__((aligned(STRIPED_MAP_CACHE_LINE))) striped_map_stripe_t;
+
+typedef struct {
+	striped_map_stripe_t *stripes;
+	unsigned int stripe_bits;
+} striped_map_t;
+
+// mix all bits of the key into the hash (murmur3 finalizer)
+static inline unsigned int striped_map_hash(int key) {
+	unsigned int h = (unsigned int)key;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+static inline striped_map_stripe_t *striped_map_stripe(striped_map_t *map, unsigned int hash) {
+	return &map->stripes[map->stripe_bits == 0 ? 0 : hash >> (32 - map->stripe_bits)];
+}
+
+// initialize with given no. of stripes rounded up to a power of 2,
+// return 0 if out of memory
+static inline int striped_map_init(striped_map_t *map, unsigned int stripes) {
+	unsigned int i;
+	map->stripe_bits = 0;
+	while ((1u << map->stripe_bits) < stripes && map->stripe_bits < 16) {
+		map->stripe_bits = map->stripe_bits + 1;
+	}
+	stripes = 1u << map->stripe_bits;
+
+	map->stripes = aligned_alloc(STRIPED_MAP_CACHE_LINE, stripes * sizeof(striped_map_stripe_t));
+	if (map->stripes == NULL) {
+		return 0;
+	}
+	for (i = 0; i < stripes; ++i) {
+		futex_rwlock_init(&map->stripes[i].lock);
+		map->stripes[i].entries = calloc(STRIPED_MAP_STRIPE_SLOTS, sizeof(striped_map_entry_t));
+		map->stripes[i].capacity = STRIPED_MAP_STRIPE_SLOTS;
+		map->stripes[i].count = 0;
+		if (map->stripes[i].entries == NULL) {
+			while (i-- > 0) {
+				free(map->stripes[i].entries);
+			}
+			free(map->stripes);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static inline void striped_map_destroy(striped_map_t *map) {
+	unsigned int i;
+	for (i = 0; i < (1u << map->stripe_bits); ++i) {
+		free(map->stripes[i].entries);
+	}
+	free(map->stripes);
+}
+
+// return slot of key in the stripe, or the empty slot where it would go
+static inline unsigned int striped_map_probe(striped_map_stripe_t *stripe, int key, unsigned int hash) {
+	unsigned int mask = stripe->capacity - 1, slot = hash & mask;
+	while (stripe->entries[slot].used && stripe->entries[slot].key != key) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+// double the stripe's table, caller holds the stripe's write lock.
+// Return 0 if out of memory, the old table is kept then
+static inline int striped_map_grow(striped_map_stripe_t *stripe) {
+	striped_map_entry_t *old_entries = stripe->entries;
+	unsigned int old_capacity = stripe->capacity, i;
+
+	stripe->entries = calloc(old_capacity * 2, sizeof(striped_map_entry_t));
+	if (stripe->entries == NULL) {
+		stripe->entries = old_entries;
+		return 0;
+	}
+	stripe->capacity = old_capacity * 2;
+	for (i = 0; i < old_capacity; ++i) {
+		if (old_entries[i].used) {
+			int key = old_entries[i].key;
+			stripe->entries[striped_map_probe(stripe, key, striped_map_hash(key))] = old_entries[i];
+		}
+	}
+	free(old_entries);
+	return 1;
+}
+
+// find or insert the slot of key, caller holds the stripe's write lock.
+// Return the slot or -1 if out of memory
+static inline long striped_map_slot_for_write(striped_map_stripe_t *stripe, int key, unsigned int hash, int value) {
+	unsigned int slot = striped_map_probe(stripe, key, hash);
+	if (stripe->entries[slot].used) {
+		return slot;
+	}
+	// keep the stripe at most 3/4 full so probes stay short
+	if ((stripe->count + 1) * 4 > stripe->capacity * 3) {
+		if (!striped_map_grow(stripe)) {
+			return -1;
+		}
+		slot = striped_map_probe(stripe, key, hash);
+	}
+	stripe->entries[slot].key = key;
+	stripe->entries[slot].value = value;
+	stripe->entries[slot].used = 1;
+	stripe->count = stripe->count + 1;
+	return slot;
+}
+
+// copy value of key into *value, return 1 if the key is present
+static inline int striped_map_get(striped_map_t *map, int key, int *value) {
+	unsigned int hash = striped_map_hash(key);
+	striped_map_stripe_t *stripe = striped_map_stripe(map, hash);
+	int found;
+
+	futex_rwlock_lock_shared(&stripe->lock);
+	unsigned int slot = striped_map_probe(stripe, key, hash);
+	found = stripe->entries[slot].used;
+	if (found) {
+		*value = stripe->entries[slot].value;
+	}
+	futex_rwlock_unlock_shared(&stripe->lock);
+	return found;
+}
+
+// insert key or replace its value, return 0 if out of memory
+static inline int striped_map_put(striped_map_t *map, int key, int value) {
+	unsigned int hash = striped_map_hash(key);
+	striped_map_stripe_t *stripe = striped_map_stripe(map, hash);
+
+	futex_rwlock_lock(&stripe->lock);
+	long slot = striped_map_slot_for_write(stripe, key, hash, value);
+	if (slot >= 0) {
+		stripe->entries[slot].value = value;
+	}
+	futex_rwlock_unlock(&stripe->lock);
+	return slot >= 0;
+}
+
+// add delta to the value of key (0 if absent) in one step and store the
+// new value in *value, return 0 if out of memory
+static inline int striped_map_add(striped_map_t *map, int key, int delta, int *value) {
+	unsigned int hash = striped_map_hash(key);
+	striped_map_stripe_t *stripe = striped_map_stripe(map, hash);
+
+	futex_rwlock_lock(&stripe->lock);
+	long slot = striped_map_slot_for_write(stripe, key, hash, 0);
+	if (slot >= 0) {
+		stripe->entries[slot].value = stripe->entries[slot].value + delta;
+		*value = stripe->entries[slot].value;
+	}
+	futex_rwlock_unlock(&stripe->lock);
+	return slot >= 0;
+}
+
+// remove key, return 1 if it was present
+static inline int striped_map_remove(striped_map_t *map, int key) {
+	unsigned int hash = striped_map_hash(key);
+	striped_map_stripe_t *stripe = striped_map_stripe(map, hash);
+
+	futex_rwlock_lock(&stripe->lock);
+	unsigned int mask = stripe->capacity - 1, hole = striped_map_probe(stripe, key, hash);
+	int found = stripe->entries[hole].used;
+	if (found) {
+		// shift back every following entry of the run that may fill the hole
+		unsigned int slot = hole;
+		while (1) {
+			slot = (slot + 1) & mask;
+			if (!stripe->entries[slot].used) {
+				break;
+			}
+			unsigned int home = striped_map_hash(stripe->entries[slot].key) & mask;
+			// entry can move if its home is not cyclically in (hole, slot]
+			if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+				stripe->entries[hole] = stripe->entries[slot];
+				hole = slot;
+			}
+		}
+		stripe->entries[hole].used = 0;
+		stripe->count = stripe->count - 1;
+	}
+	futex_rwlock_unlock(&stripe->lock);
+	return found;
+}
+
+// return no. of keys, stripe by stripe
+static inline unsigned int striped_map_size(striped_map_t *map) {
+	unsigned int i, size = 0;
+	for (i = 0; i < (1u << map->stripe_bits); ++i) {
+		futex_rwlock_lock_shared(&map->stripes[i].lock);
+		size = size + map->stripes[i].count;
+		futex_rwlock_unlock_shared(&map->stripes[i].lock);
+	}
+	return size;
+}
+
+// call f on every key and value, holding one stripe's read lock at a time
+static inline void striped_map_for_each(striped_map_t *map, void (*f)(int key, int value, void *arg), void *arg) {
+	unsigned int i, slot;
+	for (i = 0; i < (1u << map->stripe_bits); ++i) {
+		striped_map_stripe_t *stripe = &map->stripes[i];
+		futex_rwlock_lock_shared(&stripe->lock);
+		for (slot = 0; slot < stripe->capacity; ++slot) {
+			if (stripe->entries[slot].used) {
+				f(stripe->entries[slot].key, stripe->entries[slot].value, arg);
+			}
+		}
+		futex_rwlock_unlock_shared(&stripe->lock);
+	}
+}
+
+# endif
@@ -0,0 +1,166 @@
+/*
+ *  Timeline tracing for the reader-writer lock programs and the
+ *  producer-consumer program, which includes this header by relative path.
+ *
+ *  Counters say how often threads waited, a timeline shows when, for how
+ *  long and behind whom, e.g. a convoy of writers each waiting for the
+ *  one before it. Every thread records timestamped events into its own
+ *  buffer, no lock and no atomic instruction is taken per event, only the
+ *  first event of a thread registers its buffer under a mutex.
+ *
+ *  RW_TRACE_THREAD_START(name)  - name the calling thread, begin its span
+ *  RW_TRACE_THREAD_STOP()       - end the thread's span
+ *  RW_TRACE_BEGIN(name)         - begin a span, e.g. "write lock wait"
+ *  RW_TRACE_END(name)           - end the innermost span of the thread
+ *  RW_TRACE_INSTANT(name)       - a point event, e.g. "read retry"
+ *  RW_TRACE_DUMP(path)          - write all events in Chrome trace event JSON,
+ *                                 call it once all traced threads are joined
+ *
+ *  Names must be string literals, only the pointer is stored. A buffer
+ *  keeps the last RW_TRACE_EVENTS_PER_THREAD events of its thread.
+ *
+ *  Tracing is compiled in only with -DRW_TRACE, otherwise every macro is
+ *  empty and costs nothing. Open the dump in chrome://tracing or
+ *  https://ui.perfetto.dev
+ *
+ *  Include this header from C or C++ and compile with -lpthread
+ */
+
+# ifndef RW_TRACE_H
+# define RW_TRACE_H
+
+# ifdef RW_TRACE
+
+# include <pthread.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <time.h>
+
+# ifndef RW_TRACE_EVENTS_PER_THREAD
+# define RW_TRACE_EVENTS_PER_THREAD (1 << 14)
+# endif
+
+typedef struct {
+	const char *name;
+	unsigned long long ns;
+	// Chrome trace phase, 'B' begin, 'E' end or 'i' instant
+	char phase;
+} trace_event_t;
+
+typedef struct trace_buffer {
+	const char *thread_name;
+	unsigned int tid;
+	// no. of events recorded, event i is stored at i % RW_TRACE_EVENTS_PER_THREAD
+	unsigned long long count;
+	struct trace_buffer *next;
+	trace_event_t events[RW_TRACE_EVENTS_PER_THREAD];
+} trace_buffer_t;
+
+// every buffer ever registered, buffers outlive their threads until the dump
+static trace_buffer_t *trace_buffers;
+static unsigned int trace_next_tid = 1;
+static pthread_mutex_t trace_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread trace_buffer_t *trace_thread_buffer;
+
+static inline unsigned long long trace_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// buffer of the calling thread, allocated and registered on first use
+static inline trace_buffer_t *trace_buffer(void) {
+	if (trace_thread_buffer == NULL) {
+		trace_buffer_t *buffer = (trace_buffer_t *)malloc(sizeof(trace_buffer_t));
+		if (buffer == NULL) {
+			return NULL;
+		}
+		buffer->thread_name = "thread";
+		buffer->count = 0;
+		pthread_mutex_lock(&trace_registry_lock);
+		buffer->tid = trace_next_tid++;
+		buffer->next = trace_buffers;
+		trace_buffers = buffer;
+		pthread_mutex_unlock(&trace_registry_lock);
+		trace_thread_buffer = buffer;
+	}
+	return trace_thread_buffer;
+}
+
+static inline void trace_record(const char *name, char phase) {
+	trace_buffer_t *buffer = trace_buffer();
+	if (buffer != NULL) {
+		trace_event_t *event = &buffer->events[buffer->count % RW_TRACE_EVENTS_PER_THREAD];
+		event->name = name;
+		event->ns = trace_now_ns();
+		event->phase = phase;
+		buffer->count = buffer->count + 1;
+	}
+}
+
+static inline void trace_thread_start(const char *name) {
+	trace_buffer_t *buffer = trace_buffer();
+	if (buffer != NULL) {
+		buffer->thread_name = name;
+	}
+	trace_record(name, 'B');
+}
+
+// write every buffer as Chrome trace event JSON and free them
+static inline void trace_dump(const char *path) {
+	FILE *out = fopen(path, "w");
+	trace_buffer_t *buffer, *next;
+	unsigned long long i, first;
+	int comma = 0;
+
+	pthread_mutex_lock(&trace_registry_lock);
+	if (out != NULL) {
+		fprintf(out, "{\"traceEvents\":[\n");
+	}
+	for (buffer = trace_buffers; buffer != NULL; buffer = next) {
+		next = buffer->next;
+		if (out != NULL) {
+			fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+				comma ? ",\n" : "", buffer->tid, buffer->thread_name, buffer->tid);
+			comma = 1;
+			// a full buffer starts with its oldest surviving event
+			first = buffer->count > RW_TRACE_EVENTS_PER_THREAD ? buffer->count - RW_TRACE_EVENTS_PER_THREAD : 0;
+			for (i = first; i < buffer->count; ++i) {
+				trace_event_t *event = &buffer->events[i % RW_TRACE_EVENTS_PER_THREAD];
+				fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":1,\"tid\":%u%s}",
+					event->name, event->phase, event->ns / 1000, event->ns % 1000, buffer->tid,
+					event->phase == 'i' ? ",\"s\":\"t\"" : "");
+			}
+		}
+		free(buffer);
+	}
+	trace_buffers = NULL;
+	pthread_mutex_unlock(&trace_registry_lock);
+	// the calling thread's buffer is gone too
+	trace_thread_buffer = NULL;
+
+	if (out != NULL) {
+		fprintf(out, "\n]}\n");
+		fclose(out);
+	}
+}
+
+# define RW_TRACE_THREAD_START(name) trace_thread_start(name)
+# define RW_TRACE_THREAD_STOP() trace_record("", 'E')
+# define RW_TRACE_BEGIN(name) trace_record(name, 'B')
+# define RW_TRACE_END(name) trace_record(name, 'E')
+# define RW_TRACE_INSTANT(name) trace_record(name, 'i')
+# define RW_TRACE_DUMP(path) trace_dump(path)
+
+# else
+
+# define RW_TRACE_THREAD_START(name) do { } while (0)
+# define RW_TRACE_THREAD_STOP() do { } while (0)
+# define RW_TRACE_BEGIN(name) do { } while (0)
+# define RW_TRACE_END(name) do { } while (0)
+# define RW_TRACE_INSTANT(name) do { } while (0)
+# define RW_TRACE_DUMP(path) do { } while (0)
+
+# endif
+
+# endif
@@ -19,9 +19,9 @@
 # include <stdio.h>
 # include <pthread.h>
 
-// mutex variable
-pthread_mutex_t reader_mutex_lock = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t writer_mutex_lock = PTHREAD_MUTEX_INITIALIZER;
+// mutex variable protecting reader_count and writer_count, the conditional
+// variable must always be waited on with this same mutex held
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 // conditional variable
 pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
 // reader count variable to track how many readers are reading the shared data
@@ -30,58 +30,61 @@ int reader_count, writer_count;
 int shared_data;
 
 void *writer(void *arg) {
-	pthread_mutex_lock(&writer_mutex_lock);
-        // if there is any readers or writers are into the critical section
+	pthread_mutex_lock(&lock);
+	// if there is any readers or writer into the critical section
 	// then sleep the writer thread and wait for readers or writer
-	// thread signal	
-	while (reader_count > 0) {
-		pthread_cond_wait(&cond, &writer_mutex_lock);
+	// thread signal
+	while (reader_count > 0 || writer_count == 1) {
+		pthread_cond_wait(&cond, &lock);
 	}
 	// update the write count so that other reader/writer thread
 	// should not enter into the critical section i.e set the 
 	// writer count
-	writer_count = 1;	
+	writer_count = 1;
+	pthread_mutex_unlock(&lock);
 
-	// execute wait semaphore to stop all writers and readers
-	// thread to enter into the critcal section
 	// modify the shared data
 	shared_data = shared_data + 1;
 
+	pthread_mutex_lock(&lock);
 	// reset the writer count
 	writer_count = 0;
 	// Give signal to the writers and readers thread to 
-	// enter into the critical section
-	pthread_cond_signal(&cond);
-	pthread_mutex_unlock(&writer_mutex_lock);
+	// enter into the critical section, both wait on the same
+	// conditional variable so all of them have to be woken
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+	return NULL;
 }
 
 void *reader(void *arg) {
 	// taking mutex lock
-	pthread_mutex_lock(&reader_mutex_lock);
-	// incrementing the reader count
-	reader_count = reader_count + 1;
+	pthread_mutex_lock(&lock);
 	// if the writer thead accessig the critical section then  
 	// sleep the reader thread and wait for writer thread signal
 	while (writer_count == 1) {
-		pthread_cond_wait(&cond, &writer_mutex_lock);
+		pthread_cond_wait(&cond, &lock);
 	}
+	// incrementing the reader count
+	reader_count = reader_count + 1;
 	// releasing mutex lock	
-	pthread_mutex_unlock(&reader_mutex_lock);
+	pthread_mutex_unlock(&lock);
 
 	// reading the shared variable
 	printf("%d ", shared_data);
 	
 	// taking mutex lock
-	pthread_mutex_lock(&reader_mutex_lock);
+	pthread_mutex_lock(&lock);
 	// decrementing the reader count	
 	reader_count = reader_count - 1;
 	// if the reader count is zero then give signal to the writer thread to
 	// enter into the critical section  
 	if (reader_count == 0) {
-		pthread_cond_signal(&cond);
+		pthread_cond_broadcast(&cond);
 	}	
 	// releasing mutex lock
-	pthread_mutex_unlock(&reader_mutex_lock);		
+	pthread_mutex_unlock(&lock);
+	return NULL;
 }	
 
 int main() {
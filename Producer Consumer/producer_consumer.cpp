@@ -2,8 +2,28 @@
 #include <fstream>
 #include <string>
 #include <queue>
+#include <vector>
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
 #include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "../Implementing_reader-writer_locks/trace.h"
 
 using namespace std;
 
@@ -16,6 +36,39 @@ Using multiple producers merge different files into a single output file. Ask th
 3 files, start dumping the combined content into a single put file. Continue to take input files from the
 user and keep adding them to the process. Ensure that no single producer reading from an infinite
 source (e.g. /dev/urandom) causes output application to ignore data from the other sources.
+
+Broadcast mode does the reverse, one input file is copied to several output files:
+./producer_consumer --broadcast <input file> <output file> [<output file> ...]
+The producer writes into one shared ring (BroadcastRing) and every consumer
+reads the same bytes from it with its own cursor, nothing is copied per consumer.
+
+Multiplex mode merges many non-seekable sources (named pipes, character devices
+like /dev/urandom, process output) on one or a few threads instead of one thread
+per source:
+./producer_consumer --multiplex [-j <threads>] <output file> <input> [<input> ...]
+An input starting with '!' is run as a shell command and its output is read.
+Every source is a coroutine producer (AsyncSource, async_producer) that reads
+while its fd has data and co_awaits readability from an epoll loop (EventEngine)
+otherwise, so an idle source costs no thread and no wakeup. Multiplex mode needs
+C++20 coroutines, compile with -std=c++20.
+
+./producer_consumer --check passes every byte value through merge and multiplex
+mode, with and without spilling, and reports whether the output equals the input.
+
+Merge and multiplex mode can write only the lines containing any of some fixed
+strings, like piping the output into grep -F but without writing and reading
+everything a second time (broadcast mode rejects --grep and --spill):
+./producer_consumer --grep <string> [--grep <string> ...] [mode and files as above]
+The consumer cuts what it takes from the buffer into blocks of whole lines,
+worker threads (LineFilter) search the blocks in parallel with SSE2 and the
+consumer writes the matching lines of every block in the original order.
+
+With --spill <directory> in front of the mode and files, producers don't wait when
+the consumer falls behind, the buffer spills into temp files in that directory and
+reads them back in order (see Buffer).
+
+Compile with -DRW_TRACE to write a timeline of produce / consume, waits on a full
+or empty buffer and on its lock, into trace.json (see ../Implementing_reader-writer_locks/trace.h)
 */
 
 //mutex to lock buffer
@@ -27,19 +80,101 @@ pthread_mutex_t lock;
  *
  * Purpose: Buffer class will be shared by both producer and consumer classes. Producer write item
  *			to the buffer and consumer read item from buffer
+ *
+ *			Given a spill directory, producers never wait for a slow consumer: once the
+ *			memory tier is full new items go to the disk tier instead, a write buffer that
+ *			is appended to temp segment files (unlinked at once, so nothing is left behind)
+ *			64 KB at a time. The consumer takes the memory tier first, then the segments
+ *			oldest first, read back 64 KB at a time, then what is still in the write buffer.
+ *			While anything is on the disk tier new items go there too, so the order never
+ *			changes, once the consumer caught up items go to memory again. Memory stays at
+ *			capacity items plus the write and read back buffers, disk is only limited by
+ *			the file system; if writing a segment fails spilling stops and producers wait
+ *			as without spill directory
+ *
+ *			Disk I/O runs without lock. A full write buffer becomes a chunk: under lock it
+ *			gets the next sequence no. and its place in the newest segment, then it is
+ *			written unlocked while producers and the consumer go on. The consumer takes
+ *			chunks in sequence order, waiting if the oldest one is still being written,
+ *			and reads it back unlocked too
  * 
  * Class variable: buf - it will hold the item produce by producer in FIFO fashion
  *				   capacity - maximum item can hold buffer 	 
+ *				   not_full, not_empty - signaled with lock held when an item was consumed / produced
+ *				   spill_directory - where segments are created, empty if producers wait instead
+ *				   segments, first_segment - segment files not read back completely, oldest
+ *						first, and the no. of the oldest
+ *				   chunks, next_chunk - spilled chunks oldest first, and the sequence no. of the next
+ *				   readback, readback_position - items read back from the oldest chunk
+ *				   refilling - the consumer reads a chunk back, unlocked
+ *				   pending - newest spilled items not handed to a chunk yet
+ *				   spilled_bytes - no. of items that went to the disk tier
+ *				   closed - no more items will be produced, set by close()
  */
 class Buffer
 {
+	//append only temp file, closed once full and every chunk in it is read back
+	struct Segment
+	{
+		int fd;
+		//bytes handed out to chunks
+		off_t reserved;
+		//chunks not read back yet
+		unsigned int unread;
+	};
+
+	//one write buffer worth of spilled items at offset of a segment
+	struct Chunk
+	{
+		enum State { WRITING, ON_DISK, IN_MEMORY };
+
+		unsigned long long sequence;
+		unsigned long long segment;
+		off_t offset;
+		size_t length;
+		State state;
+		//the items if writing them failed
+		string items;
+	};
+
 	queue<char> buf;
 	const unsigned int capacity;
+	pthread_cond_t not_full;
+	pthread_cond_t not_empty;
+	string spill_directory;
+	deque<Segment> segments;
+	unsigned long long first_segment;
+	deque<Chunk> chunks;
+	unsigned long long next_chunk;
+	string readback;
+	size_t readback_position;
+	bool refilling;
+	string pending;
+	unsigned long long spilled_bytes;
+	bool closed;
+
+	Buffer(const Buffer&);
+	Buffer& operator=(const Buffer&);
+
+	bool spilling() const;
+	bool spill_ready() const;
+	void flush_pending();
+	void read_back(Chunk& chunk);
+	char consume_spilled();
 
 	public:
+		//bytes per segment write and read back
+		static const unsigned int SPILL_CHUNK = 1 << 16;
+		//segment files are rolled over at this size so consumed ones can be removed
+		static const off_t SEGMENT_SIZE = 1 << 26;
+
 		Buffer(unsigned int size);
+		Buffer(unsigned int size, const string& directory);
 		void produce(char produce_item);
-		char consume();
+		void close();
+		bool consume(char& consume_item);
+		unsigned long long spilled() const;
+		~Buffer();
 };
 
 /*
@@ -51,9 +186,136 @@ class Buffer
  *
  * Returns: None
  */
-Buffer::Buffer(unsigned int size):capacity(size)
+Buffer::Buffer(unsigned int size)
+	:capacity(size), first_segment(0), next_chunk(0), readback_position(0), refilling(false),
+	 spilled_bytes(0), closed(false)
+{
+	pthread_cond_init(&not_full, NULL);
+	pthread_cond_init(&not_empty, NULL);
+}
+
+/*
+ * Function: Buffer::Buffer()
+ *
+ * Purpose: Buffer class constructor, items that don't fit capacity are spilled into
+ *			segment files in given directory instead of making producers wait
+ *
+ * Arguments: size - capacity of buffer in memory
+ *			  directory - directory of the segment files, empty to disable spilling
+ *
+ * Returns: None
+ */
+Buffer::Buffer(unsigned int size, const string& directory)
+	:capacity(size), spill_directory(directory), first_segment(0), next_chunk(0), readback_position(0),
+	 refilling(false), spilled_bytes(0), closed(false)
+{
+	pthread_cond_init(&not_full, NULL);
+	pthread_cond_init(&not_empty, NULL);
+}
+
+/*
+ * Function: Buffer::spilling()
+ *
+ * Purpose: check whether the disk tier holds items, caller holds lock
+ *
+ * Arguments: None
+ *
+ * Returns: true if items are on disk, in the write buffer or read back
+ */
+bool Buffer::spilling() const
+{
+	return !chunks.empty() || !pending.empty() || readback_position < readback.size() || refilling;
+}
+
+/*
+ * Function: Buffer::spill_ready()
+ *
+ * Purpose: check whether the oldest item of the disk tier can be taken now, it can't
+ *			while its chunk is still being written or read back, caller holds lock
+ *
+ * Arguments: None
+ *
+ * Returns: true if consume_spilled() would not wait
+ */
+bool Buffer::spill_ready() const
+{
+	if(readback_position < readback.size())
+		return true;
+	if(refilling)
+		return false;
+	if(!chunks.empty())
+		return chunks.front().state != Chunk::WRITING;
+	return !pending.empty();
+}
+
+/*
+ * Function: Buffer::flush_pending()
+ *
+ * Purpose: hand the write buffer over to a new chunk at the end of the newest segment, a new
+ *			segment is created if there is none or the newest is full, and write the chunk
+ *			with lock released. If the segment can't be created spilling is disabled and the
+ *			items stay in the write buffer, if the write fails they stay in the chunk in memory
+ *			and spilling is disabled too. Caller holds lock, it is held again on return
+ *
+ * Arguments: None
+ *
+ * Returns: void
+ */
+void Buffer::flush_pending()
 {
+	//once per SEGMENT_SIZE bytes, cheap enough to do locked
+	if(segments.empty() || segments.back().reserved >= SEGMENT_SIZE)
+	{
+		string path = spill_directory + "/buffer_spill_XXXXXX";
+		Segment segment = { mkstemp(&path[0]), 0, 0 };
+		if(segment.fd < 0)
+		{
+			cout<<"\nException caused : "<<spill_directory<<" spill file can not be created !"<<endl;
+			spill_directory.clear();
+			return;
+		}
+		//the file lives as long as it is open
+		unlink(path.c_str());
+		segments.push_back(segment);
+	}
+
+	Segment& segment = segments.back();
+	Chunk chunk = { next_chunk++, first_segment + segments.size() - 1, segment.reserved, pending.size(),
+		Chunk::WRITING, string() };
+	segment.reserved += chunk.length;
+	segment.unread++;
+	chunks.push_back(chunk);
+	int fd = segment.fd;
+	string items;
+	items.swap(pending);
+	pthread_mutex_unlock(&lock);
+
+	RW_TRACE_BEGIN("spill");
+	size_t done = 0;
+	while(done < items.size())
+	{
+		ssize_t length = pwrite(fd, items.data() + done, items.size() - done, chunk.offset + done);
+		if(length < 0 && errno == EINTR)
+			continue;
+		if(length <= 0)
+			break;
+		done += length;
+	}
+	RW_TRACE_END("spill");
 
+	pthread_mutex_lock(&lock);
+	//the consumer never takes a chunk being written, so it is still queued
+	Chunk& written = chunks[chunk.sequence - chunks.front().sequence];
+	if(done == items.size())
+		written.state = Chunk::ON_DISK;
+	else
+	{
+		cout<<"\nException caused : "<<spill_directory<<" spill file can not be written !"<<endl;
+		spill_directory.clear();
+		written.items.swap(items);
+		written.state = Chunk::IN_MEMORY;
+	}
+	pthread_cond_broadcast(&not_empty);
 }
 
 /*
@@ -67,193 +329,1407 @@ Buffer::Buffer(unsigned int size):capacity(size)
  */
 void Buffer::produce(char produce_item)
 {
-	//wait until buffer is not free
-	while(buf.size() == capacity);
-	
 	//aquired mutex lock
+	RW_TRACE_BEGIN("buffer lock wait");
 	pthread_mutex_lock(&lock);
+	RW_TRACE_END("buffer lock wait");
+
+	if(!spill_directory.empty() && (spilling() || buf.size() == capacity))
+	{
+		//memory is full or older items are on disk, keep the order by spilling behind them
+		spilled_bytes++;
+		pending.push_back(produce_item);
+		if(pending.size() >= SPILL_CHUNK)
+			flush_pending();
+		pthread_cond_signal(&not_empty);
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+
+	//sleep until buffer is not full and nothing spilled is left, a blocked producer burns no CPU
+	if(buf.size() == capacity || spilling())
+	{
+		RW_TRACE_BEGIN("buffer full wait");
+		while(buf.size() == capacity || spilling())
+			pthread_cond_wait(&not_full, &lock);
+		RW_TRACE_END("buffer full wait");
+	}
+
+	RW_TRACE_BEGIN("produce");
 	    //wrote item into buffer produce by producer
 		buf.push(produce_item);
+		pthread_cond_signal(&not_empty);
+	RW_TRACE_END("produce");
 	//relase mutex lock
 	pthread_mutex_unlock(&lock);
 }
 
 /*
- * Function: Buffer::consume()
+ * Function: Buffer::close()
+ *
+ * Purpose: mark the end of the stream, every producer is done. The end is a flag beside
+ *			the items and not an item itself, so every byte value can pass the buffer
+ *
+ * Arguments: None
+ *
+ * Returns: void
+ */
+void Buffer::close()
+{
+	pthread_mutex_lock(&lock);
+	closed = true;
+	pthread_cond_broadcast(&not_empty);
+	pthread_mutex_unlock(&lock);
+}
+
+/*
+ * Function: Buffer::read_back()
+ *
+ * Purpose: read the items of a chunk taken off the queue into the read back buffer, with
+ *			lock released while reading, and close segments every chunk of is read back.
+ *			Caller holds lock, it is held again on return
+ *
+ * Arguments: chunk - oldest chunk, written
+ *
+ * Returns: void
+ */
+void Buffer::read_back(Chunk& chunk)
+{
+	string items;
+	if(chunk.state == Chunk::IN_MEMORY)
+		items.swap(chunk.items);
+	else
+	{
+		int fd = segments[chunk.segment - first_segment].fd;
+		refilling = true;
+		pthread_mutex_unlock(&lock);
+
+		RW_TRACE_BEGIN("refill");
+		items.resize(chunk.length);
+		size_t done = 0;
+		while(done < items.size())
+		{
+			ssize_t length = pread(fd, &items[done], items.size() - done, chunk.offset + done);
+			if(length < 0 && errno == EINTR)
+				continue;
+			if(length <= 0)
+			{
+				//spilled items can't be read back, better stop than reorder or invent data
+				cout<<"\nException caused : spill file can not be read !"<<endl;
+				abort();
+			}
+			done += length;
+		}
+		RW_TRACE_END("refill");
+
+		pthread_mutex_lock(&lock);
+		refilling = false;
+	}
+	readback.swap(items);
+	readback_position = 0;
+
+	//drop segments that are full and read back completely
+	segments[chunk.segment - first_segment].unread--;
+	while(!segments.empty() && segments.front().unread == 0
+		&& (segments.size() > 1 || segments.front().reserved >= SEGMENT_SIZE))
+	{
+		::close(segments.front().fd);
+		segments.pop_front();
+		first_segment++;
+	}
+}
+
+/*
+ * Function: Buffer::consume_spilled()
  *
- * Purpose: it will consume item from buffer 
+ * Purpose: take the oldest item of the disk tier, reading back the oldest chunk or taking
+ *			over the write buffer when the read back one is used up, caller holds lock
+ *			and spill_ready() is true
  *
  * Arguments: None
  *
- * Returns:  consume_item 
+ * Returns: consume_item
  */
-char Buffer::consume()
+char Buffer::consume_spilled()
 {
-	while(buf.size() == 0);
+	if(readback_position == readback.size())
+	{
+		if(chunks.empty())
+		{
+			//nothing on disk, the write buffer holds the oldest spilled items
+			readback.swap(pending);
+			pending.clear();
+			readback_position = 0;
+		}
+		else
+		{
+			Chunk chunk = move(chunks.front());
+			chunks.pop_front();
+			read_back(chunk);
+		}
+	}
+
+	char consume_item = readback[readback_position++];
+	//disk tier drained, producers go back to memory
+	if(!spilling())
+	{
+		readback.clear();
+		readback_position = 0;
+		pthread_cond_broadcast(&not_full);
+	}
+	return consume_item;
+}
 
+/*
+ * Function: Buffer::consume()
+ *
+ * Purpose: it will consume item from buffer, waiting for one unless the buffer is closed
+ *
+ * Arguments: consume_item - set to the consumed item
+ *
+ * Returns:  false once the buffer is closed and every item is consumed
+ */
+bool Buffer::consume(char& consume_item)
+{
+	RW_TRACE_BEGIN("buffer lock wait");
 	pthread_mutex_lock(&lock);
-		char consume_item = buf.front();
+	RW_TRACE_END("buffer lock wait");
+
+	//wait for an item that can be taken now, or the end of the stream
+	if(buf.size() == 0 && !spill_ready() && !(closed && !spilling()))
+	{
+		RW_TRACE_BEGIN("buffer empty wait");
+		while(buf.size() == 0 && !spill_ready() && !(closed && !spilling()))
+			pthread_cond_wait(&not_empty, &lock);
+		RW_TRACE_END("buffer empty wait");
+	}
+
+	//closed and drained, end of stream
+	if(buf.size() == 0 && !spilling())
+	{
+		pthread_mutex_unlock(&lock);
+		return false;
+	}
+
+	RW_TRACE_BEGIN("consume");
+	//memory holds the oldest items, the disk tier only what came after them
+	if(buf.size() != 0)
+	{
+		consume_item = buf.front();
 		buf.pop();
+		pthread_cond_signal(&not_full);
+	}
+	else
+		consume_item = consume_spilled();
+	RW_TRACE_END("consume");
 	pthread_mutex_unlock(&lock);
 	
-	return consume_item;
+	return true;
 }
 
 /*
- * Class: Producer
+ * Function: Buffer::spilled()
  *
- * Purpose: Producer class will read item from source file and write that item into buffer
- *			
- * Class variable: fin - ifstream object to open file into read mode
- *				   source_file - contains name of source file  	 
+ * Purpose: return no. of items that went to the disk tier so far
+ *
+ * Arguments: None
+ *
+ * Returns: no. of items
  */
-class Producer
+unsigned long long Buffer::spilled() const
 {
-	ifstream fin;
-	string source_file;
+	pthread_mutex_lock(&lock);
+	unsigned long long items = spilled_bytes;
+	pthread_mutex_unlock(&lock);
+	return items;
+}
+
+/*
+ * Function: Buffer::~Buffer()
+ *
+ * Purpose: Buffer destructor, it will close segment files not consumed
+ *
+ * Arguments: None
+ *
+ * Returns: None
+ */
+Buffer::~Buffer()
+{
+	for(size_t i=0;i<segments.size();++i)
+		::close(segments[i].fd);
+	pthread_cond_destroy(&not_full);
+	pthread_cond_destroy(&not_empty);
+}
+
+/*
+ * Class: BroadcastRing
+ *
+ * Purpose: single producer, multi consumer ring in the style of the LMAX disruptor.
+ *			The producer publishes bytes by advancing one sequence no., every consumer
+ *			keeps its own sequence no. of the bytes it has consumed and reads straight
+ *			from the ring. The producer may only reuse bytes every consumer is past, so
+ *			the slowest consumer gates the producer. Lag of a consumer is the no. of
+ *			published bytes it has not consumed yet
+ *
+ * Class variable: ring - capacity bytes, sequence no. s is stored at s % capacity
+ *				   published - no. of bytes written by the producer so far
+ *				   cursors - consumed sequence no. and largest lag seen, per consumer
+ *				   gate - smallest consumer sequence no. last seen by the producer
+ */
+class BroadcastRing
+{
+	//one consumer's cursor alone on its cache line, so consumers don't slow each other
+	struct Cursor
+	{
+		atomic<unsigned long long> sequence;
+		atomic<unsigned long long> max_lag;
+		char pad[64 - 2 * sizeof(atomic<unsigned long long>)];
+	};
+
+	char *ring;
+	const unsigned int capacity;
+	const unsigned int consumers;
+	Cursor *cursors;
+	unsigned long long gate;
+	alignas(64) atomic<unsigned long long> published;
+	atomic<bool> finished;
+
+	BroadcastRing(const BroadcastRing&);
+	BroadcastRing& operator=(const BroadcastRing&);
+
 	public:
-		Producer();
-		Producer(const string& file_name);
-		void read(Buffer& buf);
-		~Producer();
+		BroadcastRing(unsigned int size, unsigned int no_of_consumers);
+		char* claim(unsigned int& length);
+		void publish(unsigned int length);
+		void close();
+		const char* poll(unsigned int consumer, unsigned int& length);
+		void release(unsigned int consumer, unsigned int length);
+		unsigned long long lag(unsigned int consumer) const;
+		unsigned long long max_lag(unsigned int consumer) const;
+		unsigned long long consumed(unsigned int consumer) const;
+		bool drained() const;
+		~BroadcastRing();
 };
 
 /*
- * Function: Producer::Producer()
+ * Function: BroadcastRing::BroadcastRing()
  *
- * Purpose: Producer constructor, it will take input file and open it into read mode, 
- 			raised exception if file Doesn't exist or don't have read permission !  
+ * Purpose: BroadcastRing constructor, it will allocate ring and one cursor per consumer
  *
- * Arguments: input file
+ * Arguments: size - capacity of the ring in bytes
+ *			  no_of_consumers - no. of consumers reading every byte
  *
- * Returns:  None 
+ * Returns: None
  */
-Producer::Producer(const string& file_name)
+BroadcastRing::BroadcastRing(unsigned int size, unsigned int no_of_consumers)
+	: capacity(size), consumers(no_of_consumers), gate(0), published(0), finished(false)
 {
-	source_file = file_name;
-	//opening file into reading mode 
-	fin.open(source_file.c_str());
-	//raied exception if file doesn't exist or don't have read permission !
-	if(!fin.is_open())
-		throw string("file Doesn't Exist or Don't have read permission !");
+	ring = new char[capacity];
+	cursors = new Cursor[consumers];
+	for(unsigned int i=0;i<consumers;++i)
+	{
+		cursors[i].sequence.store(0);
+		cursors[i].max_lag.store(0);
+	}
+}
+
+/*
+ * Function: BroadcastRing::claim()
+ *
+ * Purpose: wait until the slowest consumer has freed at least one byte, then return
+ *			the free bytes following the published ones that are contiguous in the ring
+ *
+ * Arguments: length - set to no. of bytes that may be written at the returned address
+ *
+ * Returns: address to write to
+ */
+char* BroadcastRing::claim(unsigned int& length)
+{
+	unsigned long long next = published.load(memory_order_relaxed);
+
+	//recompute the gate from every cursor only when the cached one says full
+	if(next - gate >= capacity)
+		RW_TRACE_BEGIN("ring full wait");
+	while(next - gate >= capacity)
+	{
+		unsigned long long slowest = next;
+		for(unsigned int i=0;i<consumers;++i)
+		{
+			unsigned long long sequence = cursors[i].sequence.load(memory_order_acquire);
+			if(sequence < slowest)
+				slowest = sequence;
+		}
+		gate = slowest;
+		if(next - gate >= capacity)
+			sched_yield();
+		else
+			RW_TRACE_END("ring full wait");
+	}
+
+	unsigned int offset = next % capacity;
+	unsigned long long free_bytes = capacity - (next - gate);
+	length = free_bytes < capacity - offset ? free_bytes : capacity - offset;
+	return ring + offset;
+}
+
+/*
+ * Function: BroadcastRing::publish()
+ *
+ * Purpose: make length bytes written after claim() visible to every consumer
+ *
+ * Arguments: length - no. of bytes written
+ *
+ * Returns: void
+ */
+void BroadcastRing::publish(unsigned int length)
+{
+	RW_TRACE_INSTANT("publish");
+	published.store(published.load(memory_order_relaxed) + length, memory_order_release);
+}
+
+/*
+ * Function: BroadcastRing::close()
+ *
+ * Purpose: producer has published everything, consumers stop once they consumed it
+ *
+ * Arguments: None
+ *
+ * Returns: void
+ */
+void BroadcastRing::close()
+{
+	finished.store(true, memory_order_release);
+}
+
+/*
+ * Function: BroadcastRing::poll()
+ *
+ * Purpose: wait until bytes the consumer has not consumed are published, then return
+ *			them as far as they are contiguous in the ring
+ *
+ * Arguments: consumer - index of the consumer
+ *			  length - set to no. of bytes readable at the returned address,
+ *					   0 if the producer closed the ring and everything is consumed
+ *
+ * Returns: address to read from
+ */
+const char* BroadcastRing::poll(unsigned int consumer, unsigned int& length)
+{
+	unsigned long long sequence = cursors[consumer].sequence.load(memory_order_relaxed);
+	unsigned long long available;
+
+	bool empty = published.load(memory_order_acquire) == sequence;
+	if(empty)
+		RW_TRACE_BEGIN("ring empty wait");
+	while((available = published.load(memory_order_acquire)) == sequence)
+	{
+		//check finished before published again so no byte published before closing is missed
+		if(finished.load(memory_order_acquire) && published.load(memory_order_acquire) == sequence)
+		{
+			RW_TRACE_END("ring empty wait");
+			length = 0;
+			return NULL;
+		}
+		sched_yield();
+	}
+	if(empty)
+		RW_TRACE_END("ring empty wait");
+
+	unsigned long long lag = available - sequence;
+	if(lag > cursors[consumer].max_lag.load(memory_order_relaxed))
+		cursors[consumer].max_lag.store(lag, memory_order_relaxed);
+
+	unsigned int offset = sequence % capacity;
+	length = lag < capacity - offset ? lag : capacity - offset;
+	return ring + offset;
+}
+
+/*
+ * Function: BroadcastRing::release()
+ *
+ * Purpose: consumer is done with length bytes returned by poll(), producer may reuse them
+ *			once every other consumer is done with them too
+ *
+ * Arguments: consumer - index of the consumer
+ *			  length - no. of bytes consumed
+ *
+ * Returns: void
+ */
+void BroadcastRing::release(unsigned int consumer, unsigned int length)
+{
+	Cursor& cursor = cursors[consumer];
+	cursor.sequence.store(cursor.sequence.load(memory_order_relaxed) + length, memory_order_release);
+}
+
+/*
+ * Function: BroadcastRing::lag()
+ *
+ * Purpose: return no. of published bytes the consumer has not consumed yet
+ *
+ * Arguments: consumer - index of the consumer
+ *
+ * Returns: lag in bytes
+ */
+unsigned long long BroadcastRing::lag(unsigned int consumer) const
+{
+	unsigned long long sequence = cursors[consumer].sequence.load(memory_order_acquire);
+	return published.load(memory_order_acquire) - sequence;
+}
+
+/*
+ * Function: BroadcastRing::max_lag()
+ *
+ * Purpose: return largest lag the consumer found when it polled
+ *
+ * Arguments: consumer - index of the consumer
+ *
+ * Returns: lag in bytes
+ */
+unsigned long long BroadcastRing::max_lag(unsigned int consumer) const
+{
+	return cursors[consumer].max_lag.load(memory_order_relaxed);
 }
 
 /*
- * Function: Producer::read()
- *
- * Purpose: read item from input file and write it into buffer   
+ * Function: BroadcastRing::consumed()
+ *
+ * Purpose: return no. of bytes the consumer has consumed
+ *
+ * Arguments: consumer - index of the consumer
+ *
+ * Returns: bytes
+ */
+unsigned long long BroadcastRing::consumed(unsigned int consumer) const
+{
+	return cursors[consumer].sequence.load(memory_order_acquire);
+}
+
+/*
+ * Function: BroadcastRing::drained()
+ *
+ * Purpose: check whether the producer closed the ring and every consumer consumed everything
+ *
+ * Arguments: None
+ *
+ * Returns: true if nothing is left to do
+ */
+bool BroadcastRing::drained() const
+{
+	if(!finished.load(memory_order_acquire))
+		return false;
+	for(unsigned int i=0;i<consumers;++i)
+		if(lag(i) != 0)
+			return false;
+	return true;
+}
+
+/*
+ * Function: BroadcastRing::~BroadcastRing()
+ *
+ * Purpose: BroadcastRing destructor, it will delete ring and cursors
+ *
+ * Arguments: None
+ *
+ * Returns: None
+ */
+BroadcastRing::~BroadcastRing()
+{
+	delete[] ring;
+	delete[] cursors;
+}
+
+/*
+ * Class: Producer
+ *
+ * Purpose: Producer class will read item from source file and write that item into buffer
+ *			
+ * Class variable: fin - ifstream object to open file into read mode
+ *				   source_file - contains name of source file  	 
+ */
+class Producer
+{
+	ifstream fin;
+	string source_file;
+	public:
+		Producer();
+		Producer(const string& file_name);
+		void read(Buffer& buf);
+		void read(BroadcastRing& ring);
+		~Producer();
+};
+
+/*
+ * Function: Producer::Producer()
+ *
+ * Purpose: Producer constructor, it will take input file and open it into read mode, 
+ 			raised exception if file Doesn't exist or don't have read permission !  
+ *
+ * Arguments: input file
+ *
+ * Returns:  None 
+ */
+Producer::Producer(const string& file_name)
+{
+	source_file = file_name;
+	//opening file into reading mode 
+	fin.open(source_file.c_str());
+	//raied exception if file doesn't exist or don't have read permission !
+	if(!fin.is_open())
+		throw string("file Doesn't Exist or Don't have read permission !");
+}
+
+/*
+ * Function: Producer::read()
+ *
+ * Purpose: read item from input file and write it into buffer   
+ *
+ * Arguments: Buffer object 
+ *
+ * Returns:  void 
+ */
+void Producer::read(Buffer& buf)
+{
+	char ch;
+
+	//checked file is already opened or not ?
+	if(fin.is_open())
+	{
+		//read input file till the end, get fails at the end and nothing is produced for it
+		while(fin.get(ch))
+		{
+    		//produced item to buffer from input file
+    		buf.produce(ch);
+    	}
+	}	
+}  
+
+/*
+ * Function: Producer::read()
+ *
+ * Purpose: read input file straight into the free part of the broadcast ring, as
+ *			much as fits at once, and close the ring at the end of the file
+ *
+ * Arguments: BroadcastRing object
+ *
+ * Returns:  void
+ */
+void Producer::read(BroadcastRing& ring)
+{
+	//checked file is already opened or not ?
+	if(fin.is_open())
+	{
+		//read input file till the end
+		while(fin.good())
+		{
+			unsigned int length;
+			char *slots = ring.claim(length);
+			fin.read(slots, length);
+			ring.publish(fin.gcount());
+		}
+	}
+	ring.close();
+}
+
+/*
+ * Function: Producer::~Producer()
+ *
+ * Purpose: Producer destructor, it will closed input file as soon producer obj destroyed.  
+ *
+ * Arguments: None
+ *
+ * Returns:  None 
+ */
+Producer::~Producer()
+{
+	fin.close();
+}
+
+/*
+ * Class: LineFilter
+ *
+ * Purpose: filter stage between Buffer and Consumer, keeps the lines of a block that
+ *			contain any of the patterns. Blocks are filtered by a pool of worker threads,
+ *			the caller keeps the order by collecting results in submission order.
+ *			Candidates are found 16 bytes at a time with SSE2, a position is a candidate
+ *			if it holds the first byte of some pattern and the last byte of that pattern
+ *			follows at the right distance, only candidates are compared in full.
+ *			Without SSE2 every position is checked by its first byte
+ *
+ * Class variable: patterns - fixed strings, no newlines, an empty one matches every line
+ *				   longest - length of the longest pattern
+ *				   queued - blocks waiting for a worker, in submission order
+ *				   lock, work, finished - guard queued and Block::done, signaled when a
+ *										  block was queued / filtered
+ */
+class LineFilter
+{
+	public:
+		//block of whole lines, output gets the matching ones
+		struct Block
+		{
+			string input;
+			string output;
+			//set once output is complete, read without the lock by done()
+			atomic<bool> done;
+		};
+		//blocks are cut at the first line end after this many bytes
+		static const unsigned int BLOCK_SIZE = 1 << 16;
+
+	private:
+		vector<string> patterns;
+		size_t longest;
+		bool match_all;
+		vector<pthread_t> workers;
+		deque<Block*> queued;
+		pthread_mutex_t lock;
+		pthread_cond_t work;
+		pthread_cond_t finished;
+		bool stopping;
+
+		LineFilter(const LineFilter&);
+		LineFilter& operator=(const LineFilter&);
+
+		static void* worker_thread(void *filter);
+		bool matches_at(const char *text, size_t length, size_t at) const;
+		size_t find(const char *text, size_t length, size_t from) const;
+		void filter(const string& input, string& output) const;
+
+	public:
+		LineFilter(const vector<string>& fixed_strings, unsigned int threads);
+		Block* submit(string& input);
+		bool done(Block *block);
+		const string& wait(Block *block);
+		unsigned int capacity() const;
+		~LineFilter();
+};
+
+/*
+ * Function: LineFilter::LineFilter()
+ *
+ * Purpose: LineFilter constructor, it will start the worker threads
+ *
+ * Arguments: fixed_strings - patterns, a line matches if it contains any of them
+ *			  threads - no. of worker threads, at least 1
+ *
+ * Returns: None
+ */
+LineFilter::LineFilter(const vector<string>& fixed_strings, unsigned int threads)
+	: patterns(fixed_strings), longest(0), match_all(false), stopping(false)
+{
+	for(size_t p=0;p<patterns.size();++p)
+	{
+		match_all = match_all || patterns[p].empty();
+		if(patterns[p].size() > longest)
+			longest = patterns[p].size();
+	}
+
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&work, NULL);
+	pthread_cond_init(&finished, NULL);
+	workers.resize(threads == 0 ? 1 : threads);
+	for(size_t i=0;i<workers.size();++i)
+		pthread_create(&workers[i], NULL, worker_thread, (void*)this);
+}
+
+/*
+ * Function: LineFilter::matches_at()
+ *
+ * Purpose: check whether some pattern starts at the given position of text
+ *
+ * Arguments: text, length - the block
+ *			  at - position
+ *
+ * Returns: true if a pattern matches
+ */
+bool LineFilter::matches_at(const char *text, size_t length, size_t at) const
+{
+	for(size_t p=0;p<patterns.size();++p)
+	{
+		const string& pattern = patterns[p];
+		if(at + pattern.size() <= length && text[at] == pattern[0]
+			&& memcmp(text + at, pattern.data(), pattern.size()) == 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Function: LineFilter::find()
+ *
+ * Purpose: find the first position at or after from where some pattern starts
+ *
+ * Arguments: text, length - the block
+ *			  from - position to start at
+ *
+ * Returns: position of the match, length if there is none
+ */
+size_t LineFilter::find(const char *text, size_t length, size_t from) const
+{
+	size_t i = from;
+#if defined(__SSE2__)
+	//every load of the loop stays inside the block
+	for(; i + 16 + longest - 1 <= length; i += 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i*)(text + i));
+		unsigned int candidates = 0;
+		for(size_t p=0;p<patterns.size();++p)
+		{
+			const string& pattern = patterns[p];
+			__m128i first = _mm_cmpeq_epi8(block, _mm_set1_epi8(pattern[0]));
+			__m128i last = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(text + i + pattern.size() - 1)),
+				_mm_set1_epi8(pattern[pattern.size() - 1]));
+			candidates |= _mm_movemask_epi8(_mm_and_si128(first, last));
+		}
+		for(; candidates != 0; candidates &= candidates - 1)
+		{
+			size_t at = i + __builtin_ctz(candidates);
+			if(matches_at(text, length, at))
+				return at;
+		}
+	}
+#endif
+	for(; i < length; ++i)
+		if(matches_at(text, length, i))
+			return i;
+	return length;
+}
+
+/*
+ * Function: LineFilter::filter()
+ *
+ * Purpose: append every line of input containing a pattern to output, a line is
+ *			searched at most up to its first match
+ *
+ * Arguments: input - block of whole lines (the last one may lack its newline)
+ *			  output - matching lines
+ *
+ * Returns: void
+ */
+void LineFilter::filter(const string& input, string& output) const
+{
+	const char *text = input.data();
+	size_t length = input.size(), line = 0;
+
+	if(match_all)
+	{
+		output = input;
+		return;
+	}
+
+	while(line < length)
+	{
+		size_t at = find(text, length, line);
+		if(at == length)
+			break;
+		//patterns hold no newline, so the match lies inside one line
+		const char *start = (const char*)memrchr(text + line, '\n', at - line);
+		const char *end = (const char*)memchr(text + at, '\n', length - at);
+		size_t from = start != NULL ? start - text + 1 : line;
+		line = end != NULL ? end - text + 1 : length;
+		output.append(text + from, line - from);
+	}
+}
+
+/*
+ * Function: LineFilter::worker_thread()
+ *
+ * Purpose: filter queued blocks in turn until the filter is destroyed
+ *
+ * Arguments: LineFilter obj
+ *
+ * Returns:  NULL
+ */
+void* LineFilter::worker_thread(void *filter)
+{
+	LineFilter *self = (LineFilter*)filter;
+	RW_TRACE_THREAD_START("filter");
+
+	pthread_mutex_lock(&self->lock);
+	while(true)
+	{
+		while(self->queued.empty() && !self->stopping)
+			pthread_cond_wait(&self->work, &self->lock);
+		if(self->queued.empty())
+			break;
+		Block *block = self->queued.front();
+		self->queued.pop_front();
+		pthread_mutex_unlock(&self->lock);
+
+		RW_TRACE_BEGIN("filter block");
+		self->filter(block->input, block->output);
+		RW_TRACE_END("filter block");
+
+		pthread_mutex_lock(&self->lock);
+		block->done.store(true, memory_order_release);
+		pthread_cond_broadcast(&self->finished);
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}
+
+/*
+ * Function: LineFilter::submit()
+ *
+ * Purpose: queue a block for the workers, input is taken over and left empty
+ *
+ * Arguments: input - whole lines
+ *
+ * Returns: the block, pass it to wait() and delete it once its output is written
+ */
+LineFilter::Block* LineFilter::submit(string& input)
+{
+	Block *block = new Block();
+	block->input.swap(input);
+	block->done.store(false, memory_order_relaxed);
+
+	pthread_mutex_lock(&lock);
+	queued.push_back(block);
+	pthread_cond_signal(&work);
+	pthread_mutex_unlock(&lock);
+	return block;
+}
+
+/*
+ * Function: LineFilter::done()
+ *
+ * Purpose: check without waiting whether a block is filtered, takes no lock
+ *
+ * Arguments: block - submitted block
+ *
+ * Returns: true if wait() would return at once
+ */
+bool LineFilter::done(Block *block)
+{
+	return block->done.load(memory_order_acquire);
+}
+
+/*
+ * Function: LineFilter::wait()
+ *
+ * Purpose: wait until a block is filtered
+ *
+ * Arguments: block - submitted block
+ *
+ * Returns: matching lines of the block
+ */
+const string& LineFilter::wait(Block *block)
+{
+	pthread_mutex_lock(&lock);
+	while(!block->done.load(memory_order_relaxed))
+		pthread_cond_wait(&finished, &lock);
+	pthread_mutex_unlock(&lock);
+	return block->output;
+}
+
+/*
+ * Function: LineFilter::capacity()
+ *
+ * Purpose: no. of blocks worth keeping in flight, enough to keep every worker busy
+ *			while the oldest block is written
+ *
+ * Arguments: None
+ *
+ * Returns: no. of blocks
+ */
+unsigned int LineFilter::capacity() const
+{
+	return 2 * workers.size();
+}
+
+/*
+ * Function: LineFilter::~LineFilter()
+ *
+ * Purpose: LineFilter destructor, workers finish the queued blocks and exit
+ *
+ * Arguments: None
+ *
+ * Returns: None
+ */
+LineFilter::~LineFilter()
+{
+	pthread_mutex_lock(&lock);
+	stopping = true;
+	pthread_cond_broadcast(&work);
+	pthread_mutex_unlock(&lock);
+
+	for(size_t i=0;i<workers.size();++i)
+		pthread_join(workers[i], NULL);
+	pthread_cond_destroy(&finished);
+	pthread_cond_destroy(&work);
+	pthread_mutex_destroy(&lock);
+}
+
+/*
+ * Class: Consumer
+ *
+ * Purpose: Consumer class will read item from buffer write back it into destination file
+ *			
+ * Class variable: fout - ofstream object to write data into destination file
+ *				   des_file - contains name of destination file  	 
+ */
+class Consumer
+{
+	ofstream fout;
+	string des_file;
+	public:
+		Consumer();
+		Consumer(const string& file_name);
+		void write(Buffer& buf);
+		void write(Buffer& buf, LineFilter& filter);
+		void write(BroadcastRing& ring, unsigned int consumer);
+		~Consumer();
+};
+
+/*
+ * Function: Consumer::Consumer()
+ *
+ * Purpose: Consumer constructor, it will take the output file and open it into write mode,
+ *			raised exception if directory don't have write permission or file doesn't created  
+ *
+ * Arguments: output file
+ *
+ * Returns:  None 
+ */
+Consumer::Consumer(const string& file_name)
+{
+	des_file = file_name;
+	fout.open(des_file.c_str());
+	
+	if(!fout.is_open())
+			throw string("Doesn't created, directory don't have permission !");
+}
+
+/*
+ * Function: Consumer::write()
+ *
+ * Purpose: read item from buffer and write it into output file   
+ *
+ * Arguments: Buffer object 
+ *
+ * Returns:  void 
+ */
+void Consumer::write(Buffer& buf)
+{
+	char ch;
+	//checked output file is already opened or not ?
+	if(fout.is_open())
+	{
+		//read item from buffer until the producers closed it
+		while(buf.consume(ch))
+		{
+			//write item to output file
+			fout<<ch;
+		}
+	}	
+}  
+
+/*
+ * Function: Consumer::write()
+ *
+ * Purpose: read items from buffer in blocks of whole lines, filter the blocks in
+ *			parallel and write the matching lines into output file in block order
+ *
+ * Arguments: Buffer object, LineFilter object
+ *
+ * Returns:  void
+ */
+void Consumer::write(Buffer& buf, LineFilter& filter)
+{
+	deque<LineFilter::Block*> inflight;
+	string lines;
+	bool end = false;
+
+	while(!end)
+	{
+		char ch = 0;
+		end = !buf.consume(ch);
+		if(!end)
+			lines.push_back(ch);
+		//hand over whole lines only, a match never spans two blocks
+		bool submitted = (ch == '\n' && lines.size() >= LineFilter::BLOCK_SIZE) || (end && !lines.empty());
+		if(submitted)
+			inflight.push_back(filter.submit(lines));
+
+		//write filtered blocks in order, wait for the oldest when enough are in flight,
+		//looked at only once per block handed over, not per byte
+		while((submitted || end) && !inflight.empty()
+			&& (inflight.size() > filter.capacity() || end || filter.done(inflight.front())))
+		{
+			const string& output = filter.wait(inflight.front());
+			if(fout.is_open())
+				fout.write(output.data(), output.size());
+			delete inflight.front();
+			inflight.pop_front();
+		}
+	}
+}
+
+/*
+ * Function: Consumer::write()
+ *
+ * Purpose: write every byte of the broadcast ring into output file, reading the
+ *			ring in place through this consumer's own cursor
+ *
+ * Arguments: BroadcastRing object, index of this consumer
+ *
+ * Returns:  void
+ */
+void Consumer::write(BroadcastRing& ring, unsigned int consumer)
+{
+	unsigned int length;
+	const char *bytes;
+	//read until producer closed the ring and everything is written
+	while((bytes = ring.poll(consumer, length)) != NULL)
+	{
+		if(fout.is_open())
+			fout.write(bytes, length);
+		//let the producer reuse the bytes
+		ring.release(consumer, length);
+	}
+}
+
+/*
+ * Function: Consumer::~Consumer()
+ *
+ * Purpose: Consumer destructor, it will closed output file as soon consumer obj destroyed.  
+ *
+ * Arguments: None
+ *
+ * Returns:  None 
+ */
+Consumer::~Consumer()
+{
+	fout.close();
+}
+
+#if defined(__cpp_impl_coroutine)
+/*
+ * Class: AsyncSource
+ *
+ * Purpose: non blocking input of the event driven producers, a file, named pipe,
+ *			character device or the output of a shell command
+ *
+ * Class variable: name - file name or '!' and command
+ *				   fd - non blocking file descriptor
+ *				   process - popen'ed command, NULL for files
+ *				   fifo - named pipe, reads of 0 bytes mean end of file only after a writer hung up
+ *				   polled - registered with epoll, false for files epoll can't watch (regular
+ *							files, /dev/zero) which are always readable
+ *				   readable, hangup - readiness reported by epoll since the last empty read
+ *				   waiter - coroutine waiting for the source to become readable
+ */
+class AsyncSource
+{
+	AsyncSource(const AsyncSource&);
+	AsyncSource& operator=(const AsyncSource&);
+
+	public:
+		string name;
+		int fd;
+		FILE *process;
+		bool fifo;
+		bool polled;
+		bool readable;
+		bool hangup;
+		coroutine_handle<> waiter;
+
+		AsyncSource(const string& file_name);
+		~AsyncSource();
+};
+
+/*
+ * Function: AsyncSource::AsyncSource()
+ *
+ * Purpose: AsyncSource constructor, it will open the file or start the command and
+ *			make the fd non blocking, raised exception if that fails
+ *
+ * Arguments: file_name - input file, or '!' followed by a shell command
+ *
+ * Returns: None
+ */
+AsyncSource::AsyncSource(const string& file_name)
+	: name(file_name), fd(-1), process(NULL), fifo(false), polled(false), readable(false), hangup(false)
+{
+	if(name.size() > 1 && name[0] == '!')
+	{
+		process = popen(name.c_str() + 1, "r");
+		if(process == NULL)
+			throw string("command can not be started !");
+		fd = fileno(process);
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	}
+	else
+	{
+		//non blocking open doesn't wait for a writer of a named pipe
+		fd = open(name.c_str(), O_RDONLY | O_NONBLOCK);
+		if(fd < 0)
+			throw string("file Doesn't Exist or Don't have read permission !");
+		struct stat info;
+		fifo = fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+	}
+}
+
+/*
+ * Function: AsyncSource::~AsyncSource()
+ *
+ * Purpose: AsyncSource destructor, it will close the file or wait for the command
+ *
+ * Arguments: None
+ *
+ * Returns: None
+ */
+AsyncSource::~AsyncSource()
+{
+	if(process != NULL)
+		pclose(process);
+	else
+		close(fd);
+}
+
+/*
+ * Class: ProducerTask
+ *
+ * Purpose: return type of a coroutine producer, the coroutine starts suspended and
+ *			is resumed and destroyed only by the EventEngine it is spawned on
+ *
+ * Class variable: handle - the coroutine
+ */
+struct ProducerTask
+{
+	struct promise_type
+	{
+		ProducerTask get_return_object() { return ProducerTask{coroutine_handle<promise_type>::from_promise(*this)}; }
+		suspend_always initial_suspend() noexcept { return suspend_always(); }
+		//stay suspended when done, the engine sees done() and destroys the coroutine
+		suspend_always final_suspend() noexcept { return suspend_always(); }
+		void return_void() {}
+		void unhandled_exception() { terminate(); }
+	};
+
+	coroutine_handle<promise_type> handle;
+};
+
+/*
+ * Class: EventEngine
  *
- * Arguments: Buffer object 
+ * Purpose: runs any no. of coroutine producers on the thread calling run(). Coroutines
+ *			ready to run are resumed in turn, the engine blocks in epoll_wait only when
+ *			none is, and wakes up only for sources that became readable or hung up.
+ *			Sources are registered edge triggered, so a coroutine reads its source
+ *			until it is empty before it waits again.
  *
- * Returns:  void 
+ * Class variable: epoll_fd - epoll instance watching every polled source
+ *				   ready - coroutines to resume, in FIFO order
+ *				   live - no. of spawned coroutines not done yet
  */
-void Producer::read(Buffer& buf)
+class EventEngine
 {
-	char ch;
+	int epoll_fd;
+	deque<coroutine_handle<> > ready;
+	unsigned int live;
 
-	//checked file is already opened or not ?
-	if(fin.is_open())
-	{
-		//read input file till the end 
-		while(fin.good())
+	EventEngine(const EventEngine&);
+	EventEngine& operator=(const EventEngine&);
+
+	public:
+		//co_await engine.readable(source) suspends until epoll reports the source readable
+		struct Readable
 		{
-			//get item from input file
-    		fin.get(ch);
-    		//produced item to buffer from input file
-    		buf.produce(ch);
-    	}
-	}	
-}  
+			AsyncSource& source;
+			bool await_ready() const noexcept { return !source.polled || source.readable || source.hangup; }
+			void await_suspend(coroutine_handle<> waiter) noexcept { source.waiter = waiter; }
+			void await_resume() const noexcept {}
+		};
+
+		//co_await engine.yield() lets every other ready coroutine run first
+		struct Yield
+		{
+			EventEngine& engine;
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(coroutine_handle<> waiter) { engine.ready.push_back(waiter); }
+			void await_resume() const noexcept {}
+		};
+
+		EventEngine();
+		void add(AsyncSource& source);
+		void spawn(ProducerTask task);
+		Readable readable(AsyncSource& source) { return Readable{source}; }
+		Yield yield() { return Yield{*this}; }
+		void run();
+		~EventEngine();
+};
 
 /*
- * Function: Producer::~Producer()
+ * Function: EventEngine::EventEngine()
  *
- * Purpose: Producer destructor, it will closed input file as soon producer obj destroyed.  
+ * Purpose: EventEngine constructor, it will create the epoll instance,
+ *			raised exception if that fails
  *
  * Arguments: None
  *
- * Returns:  None 
+ * Returns: None
  */
-Producer::~Producer()
+EventEngine::EventEngine() : live(0)
 {
-	fin.close();
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(epoll_fd < 0)
+		throw string("epoll instance can not be created !");
 }
 
 /*
- * Class: Consumer
+ * Function: EventEngine::add()
  *
- * Purpose: Consumer class will read item from buffer write back it into destination file
- *			
- * Class variable: fout - ofstream object to write data into destination file
- *				   des_file - contains name of destination file  	 
+ * Purpose: watch the source for readability, files epoll refuses to watch are
+ *			marked always readable instead, raised exception on any other error
+ *
+ * Arguments: source - opened source
+ *
+ * Returns: void
  */
-class Consumer
+void EventEngine::add(AsyncSource& source)
 {
-	ofstream fout;
-	string des_file;
-	public:
-		Consumer();
-		Consumer(const string& file_name);
-		void write(Buffer& buf);
-		~Consumer();
-};
+	struct epoll_event event;
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+	event.data.ptr = &source;
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, source.fd, &event) == 0)
+		source.polled = true;
+	else if(errno != EPERM)
+		throw string("source can not be watched !");
+}
 
 /*
- * Function: Consumer::Consumer()
+ * Function: EventEngine::spawn()
  *
- * Purpose: Consumer constructor, it will take the output file and open it into write mode,
- *			raised exception if directory don't have write permission or file doesn't created  
+ * Purpose: take over a coroutine producer, it first runs once run() is called
  *
- * Arguments: output file
+ * Arguments: task - suspended coroutine
  *
- * Returns:  None 
+ * Returns: void
  */
-Consumer::Consumer(const string& file_name)
+void EventEngine::spawn(ProducerTask task)
 {
-	des_file = file_name;
-	fout.open(des_file.c_str());
-	
-	if(!fout.is_open())
-			throw string("Doesn't created, directory don't have permission !");
+	ready.push_back(task.handle);
+	live++;
 }
 
 /*
- * Function: Consumer::write()
+ * Function: EventEngine::run()
  *
- * Purpose: read item from buffer and write it into output file   
+ * Purpose: resume ready coroutines and wait for readable sources until every
+ *			spawned coroutine is done
  *
- * Arguments: Buffer object 
+ * Arguments: None
  *
- * Returns:  void 
+ * Returns: void
  */
-void Consumer::write(Buffer& buf)
+void EventEngine::run()
 {
-	char ch;
-	//checked output file is already opened or not ?
-	if(fout.is_open())
+	struct epoll_event events[64];
+
+	while(live > 0)
 	{
-		//read item from buffer until producer produces item
-		while((ch = buf.consume()) != EOF)
+		//resume every coroutine ready now once, coroutines made ready meanwhile
+		//(yielding ones) run next round, after the sources were polled again
+		for(size_t n = ready.size(); n > 0; --n)
 		{
-			//write item to output file
-			fout<<ch;
+			coroutine_handle<> coroutine = ready.front();
+			ready.pop_front();
+			coroutine.resume();
+			if(coroutine.done())
+			{
+				coroutine.destroy();
+				live--;
+			}
 		}
-	}	
-}  
+		if(live == 0)
+			break;
+
+		//block only when no coroutine is ready, idle sources cost no wakeup
+		bool idle = ready.empty();
+		if(idle)
+			RW_TRACE_BEGIN("epoll wait");
+		int count = epoll_wait(epoll_fd, events, 64, idle ? -1 : 0);
+		if(idle)
+			RW_TRACE_END("epoll wait");
+		for(int i=0;i<count;++i)
+		{
+			AsyncSource *source = (AsyncSource*)events[i].data.ptr;
+			if(events[i].events & EPOLLIN)
+				source->readable = true;
+			if(events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR))
+				source->hangup = true;
+			if(source->waiter)
+			{
+				ready.push_back(source->waiter);
+				source->waiter = nullptr;
+			}
+		}
+	}
+}
 
 /*
- * Function: Consumer::~Consumer()
+ * Function: EventEngine::~EventEngine()
  *
- * Purpose: Consumer destructor, it will closed output file as soon consumer obj destroyed.  
+ * Purpose: EventEngine destructor, it will destroy coroutines not done yet and
+ *			close the epoll instance
  *
  * Arguments: None
  *
- * Returns:  None 
+ * Returns: None
  */
-Consumer::~Consumer()
+EventEngine::~EventEngine()
 {
-	fout.close();
+	//only ready coroutines are known here, run() returns only when all are done
+	while(!ready.empty())
+	{
+		ready.front().destroy();
+		ready.pop_front();
+	}
+	close(epoll_fd);
+}
+
+/*
+ * Function: async_producer()
+ *
+ * Purpose: coroutine producer, it will read the source into buffer a chunk at a time
+ *			until end of file, waiting for readability on the engine whenever the source
+ *			is empty. After every chunk the other sources of the engine get their turn,
+ *			so an endless source like /dev/urandom can't starve them
+ *
+ * Arguments: engine - engine running the coroutine
+ *			  source - opened source, added to engine
+ *			  buf - Buffer object
+ *
+ * Returns:  ProducerTask to spawn on engine
+ */
+ProducerTask async_producer(EventEngine& engine, AsyncSource& source, Buffer& buf)
+{
+	char chunk[4096];
+
+	while(true)
+	{
+		co_await engine.readable(source);
+		ssize_t length = read(source.fd, chunk, sizeof(chunk));
+		if(length > 0)
+		{
+			for(ssize_t i=0;i<length;++i)
+				buf.produce(chunk[i]);
+			co_await engine.yield();
+		}
+		else if(length < 0 && errno == EINTR)
+			continue;
+		else if(length < 0 && errno == EAGAIN)
+			source.readable = false;
+		else if(length == 0 && source.fifo && !source.hangup)
+			//named pipe that never had a writer, wait for one
+			source.readable = false;
+		else
+			break;
+	}
 }
+#endif
 
 
 /*
@@ -264,6 +1740,8 @@ struct Pairs
 {
 	Buffer *buf;
 	string file;
+	//consumer only, filter stage or NULL to write everything
+	LineFilter *filter;
 };
 
 /*
@@ -281,6 +1759,7 @@ void* producer_thread(void *pair)
 	Pairs *mypair = (Pairs*)pair;
 	
 	string input_file = (*mypair).file;
+	RW_TRACE_THREAD_START("producer");
 	
 	//raised exception of file doesn't exist or don't have read permission
 	try
@@ -295,6 +1774,7 @@ void* producer_thread(void *pair)
 		cout<<"\nException caused : "<<input_file<<" "<<e<<endl;
 	}	
 
+	RW_TRACE_THREAD_STOP();
 	return NULL;
 }
 
@@ -314,21 +1794,334 @@ void* consumer_thread(void *pair)
 	Pairs *mypair = (Pairs*)pair;
 	
 	string output_file = (*mypair).file;
+	RW_TRACE_THREAD_START("consumer");
 	//raised exception if output directory don't have write permission
 	try
 	{
 		//create Cosumer object
 		Consumer c1(output_file.c_str());
-		//calling write function of consumer object
-		c1.write((*(*mypair).buf));
+		//calling write function of consumer object, through the filter stage if any
+		if(mypair->filter != NULL)
+			c1.write(*mypair->buf, *mypair->filter);
+		else
+			c1.write((*(*mypair).buf));
 	}
 	catch(string& e)
 	{
 		cout<<"\nException caused : "<<output_file<<" "<<e<<endl;
 	}	
 	
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}
+
+/*
+it will hold broadcast ring, file name and consumer index, passed to
+broadcast thread functions as argument
+*/
+struct BroadcastPairs
+{
+	BroadcastRing *ring;
+	string file;
+	unsigned int consumer;
+};
+
+/*
+ * Function: broadcast_producer_thread()
+ *
+ * Purpose: it will create producer object and read input file into the broadcast ring,
+ *			the ring is closed even if the file can not be opened so consumers stop
+ *
+ * Arguments: BroadcastPairs obj
+ *
+ * Returns:  NULL
+ */
+void* broadcast_producer_thread(void *pair)
+{
+	BroadcastPairs *mypair = (BroadcastPairs*)pair;
+	RW_TRACE_THREAD_START("broadcast producer");
+
+	try
+	{
+		Producer p1(mypair->file);
+		p1.read(*mypair->ring);
+	}
+	catch(string& e)
+	{
+		cout<<"\nException caused : "<<mypair->file<<" "<<e<<endl;
+		mypair->ring->close();
+	}
+
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}
+
+/*
+ * Function: broadcast_consumer_thread()
+ *
+ * Purpose: it will create consumer object and write the broadcast ring into output file,
+ *			if the file can not be created the ring is still consumed so the producer
+ *			is not blocked forever
+ *
+ * Arguments: BroadcastPairs obj
+ *
+ * Returns:  NULL
+ */
+void* broadcast_consumer_thread(void *pair)
+{
+	BroadcastPairs *mypair = (BroadcastPairs*)pair;
+	RW_TRACE_THREAD_START("broadcast consumer");
+
+	try
+	{
+		Consumer c1(mypair->file);
+		c1.write(*mypair->ring, mypair->consumer);
+	}
+	catch(string& e)
+	{
+		cout<<"\nException caused : "<<mypair->file<<" "<<e<<endl;
+		unsigned int length;
+		while(mypair->ring->poll(mypair->consumer, length) != NULL)
+			mypair->ring->release(mypair->consumer, length);
+	}
+
+	RW_TRACE_THREAD_STOP();
+	return NULL;
+}
+
+/*
+ * Function: broadcast()
+ *
+ * Purpose: copy one input file to every output file through one shared ring,
+ *			report lag of every consumer while copying
+ *
+ * Arguments: input_file, output_files
+ *
+ * Returns:  0
+ */
+int broadcast(const string& input_file, const vector<string>& output_files)
+{
+	unsigned int consumers = output_files.size();
+	//64 KB ring shared by all consumers
+	BroadcastRing ring(1 << 16, consumers);
+
+	BroadcastPairs producer_pair = { &ring, input_file, 0 };
+	vector<BroadcastPairs> consumer_pairs(consumers);
+	vector<pthread_t> consumer_thread_id(consumers);
+	pthread_t producer_thread_id;
+
+	for(unsigned int i=0;i<consumers;++i)
+	{
+		consumer_pairs[i].ring = &ring;
+		consumer_pairs[i].file = output_files[i];
+		consumer_pairs[i].consumer = i;
+		pthread_create(&consumer_thread_id[i],NULL,broadcast_consumer_thread,(void*)&consumer_pairs[i]);
+	}
+	pthread_create(&producer_thread_id,NULL,broadcast_producer_thread,(void*)&producer_pair);
+
+	//print lag of every consumer once a second until all is copied
+	for(int ticks=1;!ring.drained();++ticks)
+	{
+		usleep(10000);
+		if(ticks % 100 != 0)
+			continue;
+		cout<<"lag in bytes :";
+		for(unsigned int i=0;i<consumers;++i)
+			cout<<" "<<output_files[i]<<"="<<ring.lag(i);
+		cout<<endl;
+	}
+
+	pthread_join(producer_thread_id,NULL);
+	for(unsigned int i=0;i<consumers;++i)
+		pthread_join(consumer_thread_id[i],NULL);
+
+	for(unsigned int i=0;i<consumers;++i)
+		cout<<output_files[i]<<" : "<<ring.consumed(i)<<" bytes, max lag "<<ring.max_lag(i)<<" bytes"<<endl;
+
+	RW_TRACE_DUMP("trace.json");
+	return 0;
+}
+
+#if defined(__cpp_impl_coroutine)
+/*
+ * Function: engine_thread()
+ *
+ * Purpose: run the coroutine producers of one event engine until all are done
+ *
+ * Arguments: EventEngine obj
+ *
+ * Returns:  NULL
+ */
+void* engine_thread(void *engine)
+{
+	RW_TRACE_THREAD_START("engine");
+	((EventEngine*)engine)->run();
+	RW_TRACE_THREAD_STOP();
 	return NULL;
 }
+#endif
+
+/*
+ * Function: multiplex()
+ *
+ * Purpose: merge every input into one output file with coroutine producers spread
+ *			round robin over the given no. of event engine threads
+ *
+ * Arguments: engines - no. of engine threads
+ *			  output_file, input_files
+ *			  filter - filter stage of the consumer or NULL
+ *			  spill_directory - where the buffer spills when the consumer falls behind, empty for never
+ *
+ * Returns:  0, 1 if the program was compiled without C++20 coroutines
+ */
+int multiplex(unsigned int engines, const string& output_file, const vector<string>& input_files,
+	LineFilter *filter, const string& spill_directory)
+{
+#if defined(__cpp_impl_coroutine)
+	//thousands of sources need as many fds, raise the soft limit as far as allowed
+	struct rlimit limit;
+	if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	Buffer buf(10, spill_directory);
+	vector<EventEngine*> engine(engines);
+	vector<AsyncSource*> sources;
+	vector<pthread_t> engine_thread_id(engines);
+	pthread_t consumer_thread_id;
+
+	try
+	{
+		for(unsigned int i=0;i<engines;++i)
+			engine[i] = new EventEngine();
+	}
+	catch(string& e)
+	{
+		cout<<"\nException caused : "<<e<<endl;
+		return 1;
+	}
+
+	for(size_t i=0;i<input_files.size();++i)
+	{
+		try
+		{
+			AsyncSource *source = new AsyncSource(input_files[i]);
+			sources.push_back(source);
+			EventEngine& owner = *engine[i % engines];
+			owner.add(*source);
+			owner.spawn(async_producer(owner, *source, buf));
+		}
+		catch(string& e)
+		{
+			cout<<"\nException caused : "<<input_files[i]<<" "<<e<<endl;
+		}
+	}
+
+	Pairs consumer_pair = { &buf, output_file, filter };
+	pthread_create(&consumer_thread_id,NULL,consumer_thread,(void*)&consumer_pair);
+	for(unsigned int i=0;i<engines;++i)
+		pthread_create(&engine_thread_id[i],NULL,engine_thread,(void*)engine[i]);
+
+	for(unsigned int i=0;i<engines;++i)
+		pthread_join(engine_thread_id[i],NULL);
+	//every source is at its end, let the consumer stop
+	buf.close();
+	pthread_join(consumer_thread_id,NULL);
+	if(buf.spilled() != 0)
+		cout<<"spilled "<<buf.spilled()<<" bytes to "<<spill_directory<<endl;
+
+	for(unsigned int i=0;i<engines;++i)
+		delete engine[i];
+	for(size_t i=0;i<sources.size();++i)
+		delete sources[i];
+
+	RW_TRACE_DUMP("trace.json");
+	return 0;
+#else
+	(void)engines;
+	(void)output_file;
+	(void)input_files;
+	(void)filter;
+	(void)spill_directory;
+	cout<<"multiplex mode needs C++20 coroutines, compile with -std=c++20"<<endl;
+	return 1;
+#endif
+}
+
+/*
+ * Function: same_content()
+ *
+ * Purpose: compare two files byte by byte
+ *
+ * Arguments: first, second - file names
+ *
+ * Returns: true if both could be read and are equal
+ */
+bool same_content(const string& first, const string& second)
+{
+	ifstream a(first.c_str(), ios::binary), b(second.c_str(), ios::binary);
+	if(!a.is_open() || !b.is_open())
+		return false;
+	string content_a((istreambuf_iterator<char>(a)), istreambuf_iterator<char>());
+	string content_b((istreambuf_iterator<char>(b)), istreambuf_iterator<char>());
+	return content_a == content_b;
+}
+
+/*
+ * Function: check()
+ *
+ * Purpose: pass a file holding every byte value, 0xFF (the value of EOF as char)
+ *			included, through the buffer with a producer and a consumer thread and
+ *			through multiplex mode, with and without spilling, and compare the output
+ *			to the input
+ *
+ * Arguments: None
+ *
+ * Returns: 0 if every output equals the input, 1 otherwise
+ */
+int check()
+{
+	char input[] = "/tmp/producer_consumer_in_XXXXXX";
+	char output[] = "/tmp/producer_consumer_out_XXXXXX";
+	::close(mkstemp(input));
+	::close(mkstemp(output));
+	{
+		ofstream fout(input, ios::binary);
+		for(int i=0;i<(1 << 20);++i)
+			fout.put((char)(i * 7 % 256));
+	}
+
+	int failed = 0;
+	const char *directories[] = { "", "/tmp" };
+	for(int d=0;d<2;++d)
+	{
+		Buffer buf(10, directories[d]);
+		Pairs producer_pair = { &buf, input, NULL };
+		Pairs consumer_pair = { &buf, output, NULL };
+		pthread_t producer_thread_id, consumer_thread_id;
+		pthread_create(&consumer_thread_id,NULL,consumer_thread,(void*)&consumer_pair);
+		pthread_create(&producer_thread_id,NULL,producer_thread,(void*)&producer_pair);
+		pthread_join(producer_thread_id,NULL);
+		buf.close();
+		pthread_join(consumer_thread_id,NULL);
+		bool same = same_content(input, output);
+		cout<<"binary round trip, merge"<<(d ? ", spill" : "")<<" : "<<(same ? "ok" : "FAILED")<<endl;
+		failed += !same;
+
+#if defined(__cpp_impl_coroutine)
+		multiplex(1, output, vector<string>(1, input), NULL, directories[d]);
+		same = same_content(input, output);
+		cout<<"binary round trip, multiplex"<<(d ? ", spill" : "")<<" : "<<(same ? "ok" : "FAILED")<<endl;
+		failed += !same;
+#endif
+	}
+
+	remove(input);
+	remove(output);
+	return failed ? 1 : 0;
+}
 
 /*
  * Function: main()
@@ -342,11 +2135,61 @@ void* consumer_thread(void *pair)
  */ 
 int main(int argc, char** argv) 
 {
-	//Pairs structure will hold buf object and file and pass to thread function
-	Pairs *pair = new Pairs();
+	//lines to keep and spill directory, every --grep <string> and --spill <directory>
+	//is dropped from the arguments
+	vector<string> patterns;
+	string spill_directory;
+	while(argc >= 3 && (string(argv[1]) == "--grep" || string(argv[1]) == "--spill"))
+	{
+		if(string(argv[1]) == "--grep")
+			patterns.push_back(argv[2]);
+		else
+			spill_directory = argv[2];
+		argv += 2;
+		argc -= 2;
+	}
+	LineFilter *filter = NULL;
+	if(!patterns.empty())
+		filter = new LineFilter(patterns, sysconf(_SC_NPROCESSORS_ONLN));
+
+	//self check, every byte value must come out as it went in
+	if(argc == 2 && string(argv[1]) == "--check")
+	{
+		delete filter;
+		return check();
+	}
+
+	//broadcast mode, one input file copied to every output file
+	if(argc >= 4 && string(argv[1]) == "--broadcast")
+	{
+		//consumers read the ring in place, there is no buffer to spill and no line stage
+		if(filter != NULL || !spill_directory.empty())
+		{
+			cout<<"--grep and --spill work in merge and multiplex mode only"<<endl;
+			delete filter;
+			return 1;
+		}
+		return broadcast(argv[2], vector<string>(argv + 3, argv + argc));
+	}
+
+	//multiplex mode, every input merged by coroutine producers on few threads
+	if(argc >= 4 && string(argv[1]) == "--multiplex")
+	{
+		int first = 2;
+		unsigned int engines = 1;
+		if(string(argv[2]) == "-j" && argc >= 6)
+		{
+			engines = atoi(argv[3]) > 0 ? atoi(argv[3]) : 1;
+			first = 4;
+		}
+		int result = multiplex(engines, argv[first], vector<string>(argv + first + 1, argv + argc),
+			filter, spill_directory);
+		delete filter;
+		return result;
+	}
 
 	//create buffer with 10 character block capacity
-	Buffer *buf =  new Buffer(10);
+	Buffer *buf =  new Buffer(10, spill_directory);
 
 	int thread_counter = 0;
 	
@@ -367,13 +2210,10 @@ int main(int argc, char** argv)
 
 		//break loops if user completed their input file
 		if(input_file == "NULL")
-		{
-			//write EOF (-1) into buffer to ensure that there is no input file left to write into buffer 
-			//Hence producer has stop to produces items and now consumer 
-			//see EOF into buffer immediatlly it will stop.  
-			buf->produce(EOF);
 			break;
-		}
+		//Pairs structure will hold buf object and file and pass to thread function,
+		//one per producer as the thread may read it after the next file was entered
+		Pairs *pair = new Pairs();
 		pair->buf = buf;
 		pair->file = input_file;
 		//create producer thread for each input file
@@ -389,19 +2229,29 @@ int main(int argc, char** argv)
 			consumer_pair->buf = buf;
 			//default output file
 			consumer_pair->file = "output";
+			consumer_pair->filter = filter;
 			//create consumer thread then running it 
 			pthread_create(&consumer_thread_id,NULL,consumer_thread,(void*)consumer_pair);
 		}
 
 	}	
 
-	//joining consumer thread
-	pthread_join(consumer_thread_id,NULL);
-
 	//joining all producer thread
 	for(int i=0;i<thread_counter;++i)
 		pthread_join(producer_thread_id[i],NULL);
+
+	//no input file left to write into buffer, close it so the consumer
+	//stops once it has written everything
+	buf->close();
+
+	//joining consumer thread
+	pthread_join(consumer_thread_id,NULL);
+
+	delete filter;
+	if(buf->spilled() != 0)
+		cout<<"spilled "<<buf->spilled()<<" bytes to "<<spill_directory<<endl;
 	
+	RW_TRACE_DUMP("trace.json");
 
 	return 0;
 }
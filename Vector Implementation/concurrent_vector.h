@@ -0,0 +1,258 @@
+#ifndef CONCURRENT_VECTOR_H
+#define CONCURRENT_VECTOR_H
+
+#include <atomic>
+#include <string>
+
+/*
+Concurrent append-only int vector
+Many threads may call push_back at the same time without a global lock.
+A push_back reserves its slot with one atomic fetch-add, writes into
+segmented storage, segment k holding (FIRST_SEGMENT << k) elements, and
+sets the slot's own ready flag. No push_back ever waits for another one.
+size() is a watermark below which every slot is ready, whichever thread
+finds the slot at the watermark ready moves it forward, so a slow or
+descheduled writer only holds back the watermark, never other writers.
+Segments are never reallocated so existing elements never move, references
+stay valid and there is no copy on growth.
+
+Compile the program that includes this header with -lpthread
+*/
+
+class ConcurrentVector
+{
+    enum { FIRST_SEGMENT_BITS = 6, FIRST_SEGMENT = 1 << FIRST_SEGMENT_BITS };
+    enum { MAX_SEGMENTS = 32 - FIRST_SEGMENT_BITS };
+
+    std::atomic<int*> segments[MAX_SEGMENTS];
+    //ready flag of every slot, segmented like the values
+    std::atomic<std::atomic<unsigned char>*> ready[MAX_SEGMENTS];
+    std::atomic<unsigned int> _reserved;
+    std::atomic<unsigned int> _size;
+
+    static inline unsigned int segment_of(unsigned int index);
+    static inline unsigned int segment_base(unsigned int segment);
+    static inline unsigned int segment_capacity(unsigned int segment);
+    template <typename T> static inline T* publish(std::atomic<T*>& slot, unsigned int capacity);
+    inline int* segment(unsigned int segment);
+    inline bool is_ready(unsigned int index);
+    inline void advance();
+
+    ConcurrentVector(const ConcurrentVector&);
+    ConcurrentVector& operator=(const ConcurrentVector&);
+
+public:
+
+    inline ConcurrentVector();
+    inline unsigned int push_back(const int& value);
+    inline unsigned int size() const;
+    inline unsigned int capacity() const;
+    inline bool empty() const;
+    inline int& operator[](unsigned int index);
+    inline int& at(unsigned int index);
+    template <typename Function> inline void for_each(Function f);
+    inline ~ConcurrentVector();
+};
+
+
+/*
+Default constructor, no segment is allocated until the first push_back
+*/
+inline ConcurrentVector::ConcurrentVector()
+{
+    for (unsigned int i = 0; i < MAX_SEGMENTS; ++i)
+    {
+        segments[i].store(NULL, std::memory_order_relaxed);
+        ready[i].store(NULL, std::memory_order_relaxed);
+    }
+    _reserved.store(0, std::memory_order_relaxed);
+    _size.store(0, std::memory_order_relaxed);
+}
+
+/*
+return segment number which holds the given index, segment k covers
+indexes [FIRST_SEGMENT * (2^k - 1), FIRST_SEGMENT * (2^(k+1) - 1))
+*/
+inline unsigned int ConcurrentVector::segment_of(unsigned int index)
+{
+    unsigned long long shifted = ((unsigned long long)index >> FIRST_SEGMENT_BITS) + 1;
+    return 63 - __builtin_clzll(shifted);
+}
+
+/*
+return index of the first element stored in given segment
+*/
+inline unsigned int ConcurrentVector::segment_base(unsigned int segment)
+{
+    return (unsigned int)(FIRST_SEGMENT * ((1ull << segment) - 1));
+}
+
+/*
+return no. of elements the given segment can hold
+*/
+inline unsigned int ConcurrentVector::segment_capacity(unsigned int segment)
+{
+    return FIRST_SEGMENT << segment;
+}
+
+/*
+return the array in slot, allocating it (value initialized) if no thread did
+it yet. Racing threads each allocate, only one wins the compare-exchange and
+the others free their copy, so an array is published exactly once
+*/
+template <typename T>
+inline T* ConcurrentVector::publish(std::atomic<T*>& slot, unsigned int capacity)
+{
+    T *storage = slot.load(std::memory_order_acquire);
+    if (storage != NULL)
+        return storage;
+
+    T *fresh = new T[capacity]();
+    if (slot.compare_exchange_strong(storage, fresh,
+            std::memory_order_acq_rel, std::memory_order_acquire))
+        return fresh;
+
+    //some other thread published the array first
+    delete[] fresh;
+    return storage;
+}
+
+/*
+return the storage of given segment, allocating it if no thread did it yet
+*/
+inline int* ConcurrentVector::segment(unsigned int segment)
+{
+    return publish(segments[segment], segment_capacity(segment));
+}
+
+/*
+check whether the slot of given index is written, false as well if its
+segment's flags are not even allocated yet
+*/
+inline bool ConcurrentVector::is_ready(unsigned int index)
+{
+    unsigned int seg = segment_of(index);
+    std::atomic<unsigned char> *flags = ready[seg].load(std::memory_order_acquire);
+    return flags != NULL && flags[index - segment_base(seg)].load(std::memory_order_seq_cst);
+}
+
+/*
+move the watermark over every ready slot at it. The flag store of a
+push_back and its load of the watermark are seq_cst, as are the loads here,
+so of a writer and the thread advancing up to its slot at least one sees
+the other and the watermark never stops below a ready slot for good
+*/
+inline void ConcurrentVector::advance()
+{
+    unsigned int mark = _size.load(std::memory_order_seq_cst);
+    while (mark < _reserved.load(std::memory_order_relaxed) && is_ready(mark))
+    {
+        //on failure mark is reloaded, another thread moved it already
+        _size.compare_exchange_weak(mark, mark + 1, std::memory_order_seq_cst);
+    }
+}
+
+/*
+Reserve a slot with a compare-and-swap that refuses to go past the last
+segment, so a full vector throws without moving the counter. Store value
+in it and set the slot's ready flag, then move size() forward as far as
+slots are ready.
+Never waits for other push_backs, a slot written before an earlier one
+becomes visible in size() as soon as the earlier one is written.
+return index of the inserted element
+*/
+inline unsigned int ConcurrentVector::push_back(const int& value)
+{
+    unsigned int index = _reserved.load(std::memory_order_relaxed);
+    do
+    {
+        if (index >= segment_base(MAX_SEGMENTS))
+            throw std::string("concurrent vector is full !");
+        //on failure index is reloaded, another thread took the slot
+    } while (!_reserved.compare_exchange_weak(index, index + 1, std::memory_order_relaxed));
+
+    unsigned int seg = segment_of(index);
+    segment(seg)[index - segment_base(seg)] = value;
+    publish(ready[seg], segment_capacity(seg))[index - segment_base(seg)].store(1, std::memory_order_seq_cst);
+
+    advance();
+    return index;
+}
+
+/*
+return no. of published elements, every index below it is safe to read
+*/
+inline unsigned int ConcurrentVector::size() const
+{
+    return _size.load(std::memory_order_acquire);
+}
+
+/*
+return no. of elements the allocated segments can hold
+*/
+inline unsigned int ConcurrentVector::capacity() const
+{
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < MAX_SEGMENTS; ++i)
+        if (segments[i].load(std::memory_order_acquire) != NULL)
+            total += segment_capacity(i);
+    return total;
+}
+
+//check where vector obj empty or not
+inline bool ConcurrentVector::empty() const
+{
+    return size() == 0;
+}
+
+/*
+return reference of the element on given index, index must be less than size()
+*/
+inline int& ConcurrentVector::operator[](unsigned int index)
+{
+    unsigned int seg = segment_of(index);
+    return segments[seg].load(std::memory_order_acquire)[index - segment_base(seg)];
+}
+
+/*
+same as operator[] but raised exception for unpublished index
+*/
+inline int& ConcurrentVector::at(unsigned int index)
+{
+    if (index >= size())
+        throw std::string("index larger than vector size !");
+    return (*this)[index];
+}
+
+/*
+call f on every element published at the time of the call,
+walking one segment at a time so the inner loop is a plain array scan
+*/
+template <typename Function>
+inline void ConcurrentVector::for_each(Function f)
+{
+    unsigned int published = size();
+    for (unsigned int seg = 0; published > segment_base(seg); ++seg)
+    {
+        int *storage = segments[seg].load(std::memory_order_acquire);
+        unsigned int count = published - segment_base(seg);
+        if (count > segment_capacity(seg))
+            count = segment_capacity(seg);
+        for (unsigned int i = 0; i < count; ++i)
+            f(storage[i]);
+    }
+}
+
+/*
+destructor will delete every allocated segment
+*/
+inline ConcurrentVector::~ConcurrentVector()
+{
+    for (unsigned int i = 0; i < MAX_SEGMENTS; ++i)
+    {
+        delete[] segments[i].load(std::memory_order_relaxed);
+        delete[] ready[i].load(std::memory_order_relaxed);
+    }
+}
+
+#endif
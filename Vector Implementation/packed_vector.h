@@ -0,0 +1,319 @@
+#ifndef PACKED_VECTOR_H
+#define PACKED_VECTOR_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "vector.h"
+
+/*
+Compressed read only int vector
+PackedVector is built from a Vector and stores its values in blocks of 128.
+Every block keeps a small header (reference value, bit width, delta flag and
+offset of its packed words) so any element is found without touching other
+blocks. Inside a block values are stored as frame of reference, value minus
+the block minimum, or for sorted runs as deltas, in the fewest bits that fit.
+
+Packed words use the 4 lane layout of SIMD-BP128: value i of the block goes
+to lane i % 4 and every lane is a bit stream of 32 values, so one SSE2
+shift/and unpacks 4 values at once and delta blocks are decoded with
+4 wide prefix sums. Without SSE2 the same layout is decoded in scalar code.
+*/
+
+class PackedVector
+{
+public:
+    enum { BLOCK = 128, LANES = 4, PER_LANE = BLOCK / LANES };
+
+private:
+    struct BlockHeader
+    {
+        int reference;          //block minimum, or first 4 values base for delta
+        unsigned char bits;     //bit width of every packed value
+        unsigned char delta;    //1 if values are stored as lane deltas
+        unsigned int offset;    //index of first packed word of the block
+    };
+
+    std::vector<BlockHeader> headers;
+    std::vector<unsigned int> words;
+    unsigned int _size;
+
+    static unsigned int bit_width(unsigned int value);
+    static void pack(const unsigned int *values, unsigned int bits, unsigned int *out);
+    static void unpack(const unsigned int *in, unsigned int bits, unsigned int *values);
+    static unsigned int extract(const unsigned int *in, unsigned int bits, unsigned int index);
+    void encode_block(const int *values, unsigned int count);
+
+public:
+    explicit PackedVector(Vector& source);
+    int operator[](unsigned int index) const;
+    int at(unsigned int index) const;
+    unsigned int size() const;
+    unsigned int bytes() const;
+    unsigned int decode_block(unsigned int block, int *out) const;
+    void decode(int *out) const;
+    template <typename Function> void for_each(Function f) const;
+};
+
+
+/*
+return no. of bits needed to store value, 0 for value 0
+*/
+inline unsigned int PackedVector::bit_width(unsigned int value)
+{
+    return value == 0 ? 0 : 32 - __builtin_clz(value);
+}
+
+/*
+pack 128 values of given bit width into bits * 4 words, lane layout
+*/
+inline void PackedVector::pack(const unsigned int *values, unsigned int bits, unsigned int *out)
+{
+    if (bits == 0)
+        return;
+    memset(out, 0, bits * LANES * sizeof(unsigned int));
+
+    for (unsigned int lane = 0; lane < LANES; ++lane)
+    {
+        unsigned int position = 0;
+        for (unsigned int j = 0; j < PER_LANE; ++j, position += bits)
+        {
+            unsigned int value = values[j * LANES + lane];
+            unsigned int word = position / 32, shift = position % 32;
+            out[word * LANES + lane] |= value << shift;
+            if (shift + bits > 32)
+                out[(word + 1) * LANES + lane] |= value >> (32 - shift);
+        }
+    }
+}
+
+/*
+unpack 128 values of given bit width, SSE2 handles all 4 lanes in one register
+*/
+inline void PackedVector::unpack(const unsigned int *in, unsigned int bits, unsigned int *values)
+{
+    if (bits == 0)
+    {
+        memset(values, 0, BLOCK * sizeof(unsigned int));
+        return;
+    }
+
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(bits == 32 ? -1 : (int)((1u << bits) - 1));
+    const __m128i *lanes = (const __m128i*)in;
+    __m128i *out = (__m128i*)values;
+    __m128i current = _mm_loadu_si128(lanes);
+    unsigned int shift = 0;
+
+    for (unsigned int j = 0; j < PER_LANE; ++j)
+    {
+        __m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(shift));
+        shift += bits;
+        if (shift >= 32)
+        {
+            shift -= 32;
+            //value spills into the next word of every lane
+            if (j + 1 < PER_LANE || shift > 0)
+                current = _mm_loadu_si128(++lanes);
+            if (shift > 0)
+                value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128(bits - shift)));
+        }
+        _mm_storeu_si128(out + j, _mm_and_si128(value, mask));
+    }
+#else
+    for (unsigned int i = 0; i < BLOCK; ++i)
+        values[i] = extract(in, bits, i);
+#endif
+}
+
+/*
+return value at given index of a packed block without unpacking the rest
+*/
+inline unsigned int PackedVector::extract(const unsigned int *in, unsigned int bits, unsigned int index)
+{
+    if (bits == 0)
+        return 0;
+
+    unsigned int lane = index % LANES, position = (index / LANES) * bits;
+    unsigned int word = position / 32, shift = position % 32;
+    unsigned long long pair = in[word * LANES + lane] >> shift;
+    if (shift + bits > 32)
+        pair |= (unsigned long long)in[(word + 1) * LANES + lane] << (32 - shift);
+    return (unsigned int)(pair & ((1ull << bits) - 1));
+}
+
+/*
+encode up to 128 values as one block, choosing whichever of frame of
+reference and lane delta needs fewer bits. Short last block is padded
+by repeating its last value
+*/
+inline void PackedVector::encode_block(const int *source, unsigned int count)
+{
+    int values[BLOCK];
+    for (unsigned int i = 0; i < BLOCK; ++i)
+        values[i] = source[i < count ? i : count - 1];
+
+    //frame of reference, all values relative to block minimum
+    int minimum = values[0];
+    for (unsigned int i = 1; i < BLOCK; ++i)
+        if (values[i] < minimum)
+            minimum = values[i];
+
+    unsigned int for_values[BLOCK], for_bits = 0;
+    for (unsigned int i = 0; i < BLOCK; ++i)
+    {
+        for_values[i] = (unsigned int)values[i] - (unsigned int)minimum;
+        unsigned int width = bit_width(for_values[i]);
+        if (width > for_bits)
+            for_bits = width;
+    }
+
+    //lane delta, value i relative to value i - 4, only for non decreasing runs
+    bool sorted = true;
+    for (unsigned int i = 1; i < BLOCK && sorted; ++i)
+        sorted = values[i - 1] <= values[i];
+
+    unsigned int delta_values[BLOCK], delta_bits = 32;
+    if (sorted)
+    {
+        delta_bits = 0;
+        for (unsigned int i = 0; i < BLOCK; ++i)
+        {
+            delta_values[i] = (unsigned int)values[i] - (unsigned int)(i < LANES ? values[0] : values[i - LANES]);
+            unsigned int width = bit_width(delta_values[i]);
+            if (width > delta_bits)
+                delta_bits = width;
+        }
+    }
+
+    BlockHeader header;
+    header.offset = words.size();
+    header.delta = sorted && delta_bits < for_bits;
+    header.bits = header.delta ? delta_bits : for_bits;
+    header.reference = header.delta ? values[0] : minimum;
+    headers.push_back(header);
+
+    words.resize(words.size() + header.bits * LANES);
+    pack(header.delta ? delta_values : for_values, header.bits, words.data() + header.offset);
+}
+
+/*
+PackedVector constructor, it will encode every element of the source Vector
+*/
+inline PackedVector::PackedVector(Vector& source) : _size(source.size())
+{
+    headers.reserve((_size + BLOCK - 1) / BLOCK);
+    for (unsigned int i = 0; i < _size; i += BLOCK)
+        encode_block(source.begin() + i, _size - i < BLOCK ? _size - i : (unsigned int)BLOCK);
+    words.shrink_to_fit();
+}
+
+/*
+decode one block into out (128 values), return no. of valid values in it
+*/
+inline unsigned int PackedVector::decode_block(unsigned int block, int *out) const
+{
+    const BlockHeader& header = headers[block];
+    unsigned int *values = (unsigned int*)out;
+    unpack(words.data() + header.offset, header.bits, values);
+
+#if defined(__SSE2__)
+    __m128i running = _mm_set1_epi32(header.reference);
+    for (unsigned int j = 0; j < PER_LANE; ++j)
+    {
+        __m128i *v = (__m128i*)values + j;
+        __m128i value = _mm_add_epi32(_mm_loadu_si128(v), running);
+        _mm_storeu_si128(v, value);
+        //delta blocks carry the running sum, frame of reference blocks do not
+        if (header.delta)
+            running = value;
+    }
+#else
+    for (unsigned int i = 0; i < BLOCK; ++i)
+    {
+        unsigned int base = (unsigned int)header.reference;
+        if (header.delta && i >= LANES)
+            base = values[i - LANES];
+        values[i] += base;
+    }
+#endif
+
+    unsigned int first = block * BLOCK;
+    return _size - first < BLOCK ? _size - first : (unsigned int)BLOCK;
+}
+
+/*
+decode whole vector into out, out must have room for size() rounded up to 128
+*/
+inline void PackedVector::decode(int *out) const
+{
+    for (unsigned int b = 0; b < headers.size(); ++b)
+        decode_block(b, out + b * BLOCK);
+}
+
+/*
+call f on every value in order, decoding one block at a time in a small
+buffer that stays in L1, so a scan never materializes the whole vector
+*/
+template <typename Function>
+inline void PackedVector::for_each(Function f) const
+{
+    int block[BLOCK];
+    for (unsigned int b = 0; b < headers.size(); ++b)
+    {
+        unsigned int count = decode_block(b, block);
+        for (unsigned int i = 0; i < count; ++i)
+            f(block[i]);
+    }
+}
+
+/*
+random access through the block header, frame of reference blocks read one
+value, delta blocks sum the deltas of the value's lane up to it
+*/
+inline int PackedVector::operator[](unsigned int index) const
+{
+    const BlockHeader& header = headers[index / BLOCK];
+    const unsigned int *in = words.data() + header.offset;
+    unsigned int i = index % BLOCK;
+
+    if (!header.delta)
+        return (int)((unsigned int)header.reference + extract(in, header.bits, i));
+
+    unsigned int value = (unsigned int)header.reference;
+    for (unsigned int j = i % LANES; j <= i; j += LANES)
+        value += extract(in, header.bits, j);
+    return (int)value;
+}
+
+/*
+same as operator[] but raised index out of bound exception for invalid index
+*/
+inline int PackedVector::at(unsigned int index) const
+{
+    if (index >= _size)
+        throw std::string("index larger than vector size !");
+    return (*this)[index];
+}
+
+/*
+return no. of elements
+*/
+inline unsigned int PackedVector::size() const
+{
+    return _size;
+}
+
+/*
+return no. of bytes used by headers and packed words
+*/
+inline unsigned int PackedVector::bytes() const
+{
+    return headers.size() * sizeof(BlockHeader) + words.size() * sizeof(unsigned int);
+}
+
+#endif
@@ -0,0 +1,679 @@
+#ifndef PARALLEL_ALGORITHMS_H
+#define PARALLEL_ALGORITHMS_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+
+/*
+Parallel algorithms over Vector
+Sort, prefix-sum, transform and reduce that work directly on the
+begin()/end() range of a Vector (or any random access range).
+Work is split into tasks that run on a work-stealing thread pool, every
+worker owns a deque, pushes and pops its own tasks at the back and steals
+from the front of the other workers' deques when it runs out of work.
+
+Compile the program that includes this header with -lpthread
+*/
+
+/*
+ * Class: ThreadPool
+ *
+ * Purpose: fixed set of worker threads executing submitted tasks, idle
+ *			workers steal tasks from busy ones
+ *
+ * Class variable: queues - one task deque per worker, guarded by its own mutex
+ *				   pending - no. of submitted tasks not yet taken by any worker
+ */
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+private:
+    struct WorkerQueue
+    {
+        pthread_mutex_t lock;
+        std::deque<Task> tasks;
+    };
+
+    struct WorkerArg
+    {
+        ThreadPool *pool;
+        unsigned int id;
+    };
+
+    std::vector<WorkerQueue*> queues;
+    std::vector<pthread_t> workers;
+    std::vector<WorkerArg> args;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    std::atomic<unsigned int> pending;
+    std::atomic<unsigned int> next_queue;
+    bool stopping;
+
+    static void* worker_thread(void *arg);
+    static unsigned int& current_worker();
+    bool pop_task(unsigned int id, Task& task);
+    bool steal_task(unsigned int id, Task& task);
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+public:
+    explicit ThreadPool(unsigned int threads);
+    void submit(const Task& task);
+    bool run_one();
+    unsigned int size() const;
+    ~ThreadPool();
+};
+
+/*
+worker id of the calling thread, ~0 for threads outside the pool
+*/
+inline unsigned int& ThreadPool::current_worker()
+{
+    static __thread unsigned int id = ~0u;
+    return id;
+}
+
+/*
+Thread pool constructor, it will start given no. of worker threads
+*/
+inline ThreadPool::ThreadPool(unsigned int threads)
+    : pending(0), next_queue(0), stopping(false)
+{
+    if (threads == 0)
+        threads = 1;
+
+    pthread_mutex_init(&idle_lock, NULL);
+    pthread_cond_init(&idle_cond, NULL);
+
+    for (unsigned int i = 0; i < threads; ++i)
+    {
+        WorkerQueue *queue = new WorkerQueue();
+        pthread_mutex_init(&queue->lock, NULL);
+        queues.push_back(queue);
+    }
+
+    workers.resize(threads);
+    args.resize(threads);
+    for (unsigned int i = 0; i < threads; ++i)
+    {
+        args[i].pool = this;
+        args[i].id = i;
+        pthread_create(&workers[i], NULL, worker_thread, (void*)&args[i]);
+    }
+}
+
+/*
+push task on the calling worker's own deque, tasks submitted from outside
+the pool are spread round robin, then wake one idle worker
+*/
+inline void ThreadPool::submit(const Task& task)
+{
+    unsigned int id = current_worker();
+    if (id >= queues.size())
+        id = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    //count the task before it becomes visible so pending never goes below zero
+    pending.fetch_add(1, std::memory_order_release);
+
+    pthread_mutex_lock(&queues[id]->lock);
+    queues[id]->tasks.push_back(task);
+    pthread_mutex_unlock(&queues[id]->lock);
+
+    pthread_mutex_lock(&idle_lock);
+    pthread_cond_signal(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+/*
+take newest task from worker's own deque (LIFO keeps the working set hot)
+*/
+inline bool ThreadPool::pop_task(unsigned int id, Task& task)
+{
+    WorkerQueue *queue = queues[id];
+    pthread_mutex_lock(&queue->lock);
+    bool found = !queue->tasks.empty();
+    if (found)
+    {
+        task.swap(queue->tasks.back());
+        queue->tasks.pop_back();
+        pending.fetch_sub(1, std::memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+/*
+take oldest task from some other worker's deque, oldest tasks are
+the biggest pieces of a recursively split job
+*/
+inline bool ThreadPool::steal_task(unsigned int id, Task& task)
+{
+    for (unsigned int i = 1; i <= queues.size(); ++i)
+    {
+        WorkerQueue *queue = queues[(id + i) % queues.size()];
+        pthread_mutex_lock(&queue->lock);
+        bool found = !queue->tasks.empty();
+        if (found)
+        {
+            task.swap(queue->tasks.front());
+            queue->tasks.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&queue->lock);
+        if (found)
+            return true;
+    }
+    return false;
+}
+
+/*
+execute one queued task on the calling thread, used by threads
+waiting for a task group so that waiting never blocks a worker.
+return false if there was nothing to run
+*/
+inline bool ThreadPool::run_one()
+{
+    unsigned int id = current_worker();
+    Task task;
+    if (id < queues.size())
+    {
+        if (!pop_task(id, task) && !steal_task(id, task))
+            return false;
+    }
+    else if (!steal_task(0, task))
+        return false;
+
+    task();
+    return true;
+}
+
+/*
+worker main loop, run own tasks, steal when empty, sleep when nothing is pending
+*/
+inline void* ThreadPool::worker_thread(void *arg)
+{
+    WorkerArg *worker = (WorkerArg*)arg;
+    ThreadPool *pool = worker->pool;
+    current_worker() = worker->id;
+
+    while (true)
+    {
+        Task task;
+        if (pool->pop_task(worker->id, task) || pool->steal_task(worker->id, task))
+        {
+            task();
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idle_lock);
+        while (!pool->stopping && pool->pending.load(std::memory_order_acquire) == 0)
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        bool stop = pool->stopping && pool->pending.load(std::memory_order_acquire) == 0;
+        pthread_mutex_unlock(&pool->idle_lock);
+
+        if (stop)
+            break;
+    }
+    return NULL;
+}
+
+/*
+return no. of worker threads
+*/
+inline unsigned int ThreadPool::size() const
+{
+    return workers.size();
+}
+
+/*
+Thread pool destructor, it will finish queued tasks and join all workers
+*/
+inline ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&idle_lock);
+    stopping = true;
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+
+    for (unsigned int i = 0; i < workers.size(); ++i)
+        pthread_join(workers[i], NULL);
+
+    for (unsigned int i = 0; i < queues.size(); ++i)
+    {
+        pthread_mutex_destroy(&queues[i]->lock);
+        delete queues[i];
+    }
+    pthread_cond_destroy(&idle_cond);
+    pthread_mutex_destroy(&idle_lock);
+}
+
+/*
+return process wide pool with one worker per online cpu
+*/
+inline ThreadPool& default_thread_pool()
+{
+    static ThreadPool pool((unsigned int)sysconf(_SC_NPROCESSORS_ONLN));
+    return pool;
+}
+
+/*
+ * Class: TaskGroup
+ *
+ * Purpose: track a set of tasks submitted to a pool, wait() returns once
+ *			all of them finished, executing queued tasks while it waits
+ */
+class TaskGroup
+{
+    ThreadPool& pool;
+    std::atomic<unsigned int> remaining;
+
+    TaskGroup(const TaskGroup&);
+    TaskGroup& operator=(const TaskGroup&);
+
+public:
+    explicit TaskGroup(ThreadPool& thread_pool) : pool(thread_pool), remaining(0) {}
+
+    template <typename Function>
+    void run(Function f)
+    {
+        remaining.fetch_add(1, std::memory_order_relaxed);
+        std::atomic<unsigned int> *counter = &remaining;
+        pool.submit([f, counter]() {
+            f();
+            counter->fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    void wait()
+    {
+        while (remaining.load(std::memory_order_acquire) != 0)
+            if (!pool.run_one())
+                sched_yield();
+    }
+
+    ~TaskGroup()
+    {
+        wait();
+    }
+};
+
+/*
+no. of elements below which a range is processed serially by one task
+*/
+static const size_t PARALLEL_GRAIN = 1 << 14;
+
+/*
+call body(lo, hi) on disjoint sub ranges covering [begin, end), the range is
+split in halves recursively so idle workers steal the largest pieces first
+*/
+template <typename Body>
+inline void parallel_for(size_t begin, size_t end, size_t grain, const Body& body,
+                         ThreadPool& pool = default_thread_pool())
+{
+    if (grain == 0)
+        grain = 1;
+    if (end - begin <= grain || pool.size() == 1)
+    {
+        body(begin, end);
+        return;
+    }
+
+    TaskGroup group(pool);
+    while (end - begin > grain)
+    {
+        size_t mid = begin + (end - begin) / 2;
+        size_t hi = end;
+        group.run([mid, hi, grain, &body, &pool]() {
+            parallel_for(mid, hi, grain, body, pool);
+        });
+        end = mid;
+    }
+    body(begin, end);
+    group.wait();
+}
+
+/*
+split [0, n) into no. of blocks of at least grain elements, one or
+a few per worker, used by the multi pass algorithms (scan and radix sort)
+*/
+inline size_t parallel_block_count(size_t n, size_t grain, ThreadPool& pool)
+{
+    size_t blocks = (n + grain - 1) / grain;
+    size_t limit = pool.size() * 4;
+    if (blocks > limit)
+        blocks = limit;
+    return blocks == 0 ? 1 : blocks;
+}
+
+/*
+out[i] = op(first[i]) for every element of the range, out may equal first
+*/
+template <typename InputIt, typename OutputIt, typename UnaryOp>
+inline OutputIt parallel_transform(InputIt first, InputIt last, OutputIt out, UnaryOp op,
+                                   ThreadPool& pool = default_thread_pool())
+{
+    size_t n = last - first;
+    parallel_for(0, n, PARALLEL_GRAIN, [first, out, &op](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i)
+            out[i] = op(first[i]);
+    }, pool);
+    return out + n;
+}
+
+/*
+combine all elements of the range with op (must be associative)
+starting from init, each block is reduced serially then the block results
+are combined in order
+*/
+template <typename InputIt, typename T, typename BinaryOp>
+inline T parallel_reduce(InputIt first, InputIt last, T init, BinaryOp op,
+                         ThreadPool& pool = default_thread_pool())
+{
+    size_t n = last - first;
+    if (n == 0)
+        return init;
+
+    size_t blocks = parallel_block_count(n, PARALLEL_GRAIN, pool);
+    std::vector<T> partial(blocks);
+    parallel_for(0, blocks, 1, [first, n, blocks, &partial, &op](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; ++b)
+        {
+            size_t from = n * b / blocks, to = n * (b + 1) / blocks;
+            T acc = first[from];
+            for (size_t i = from + 1; i < to; ++i)
+                acc = op(acc, first[i]);
+            partial[b] = acc;
+        }
+    }, pool);
+
+    for (size_t b = 0; b < blocks; ++b)
+        init = op(init, partial[b]);
+    return init;
+}
+
+template <typename InputIt, typename T>
+inline T parallel_reduce(InputIt first, InputIt last, T init,
+                         ThreadPool& pool = default_thread_pool())
+{
+    return parallel_reduce(first, last, init, std::plus<T>(), pool);
+}
+
+/*
+blocked prefix scan shared by inclusive and exclusive scan,
+pass 1 reduces every block, the block totals are scanned serially,
+pass 2 rescans every block starting from its offset
+*/
+template <typename InputIt, typename OutputIt, typename T, typename BinaryOp>
+inline OutputIt parallel_scan(InputIt first, InputIt last, OutputIt out, T init,
+                              BinaryOp op, bool inclusive, ThreadPool& pool)
+{
+    size_t n = last - first;
+    if (n == 0)
+        return out;
+
+    size_t blocks = parallel_block_count(n, PARALLEL_GRAIN, pool);
+    std::vector<T> offset(blocks);
+    parallel_for(0, blocks, 1, [first, n, blocks, &offset, &op](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; ++b)
+        {
+            size_t from = n * b / blocks, to = n * (b + 1) / blocks;
+            T acc = first[from];
+            for (size_t i = from + 1; i < to; ++i)
+                acc = op(acc, first[i]);
+            offset[b] = acc;
+        }
+    }, pool);
+
+    T running = init;
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        T total = offset[b];
+        offset[b] = running;
+        running = op(running, total);
+    }
+
+    parallel_for(0, blocks, 1, [first, out, n, blocks, inclusive, &offset, &op](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; ++b)
+        {
+            size_t from = n * b / blocks, to = n * (b + 1) / blocks;
+            T acc = offset[b];
+            for (size_t i = from; i < to; ++i)
+            {
+                //read before write so that in place scan (out == first) works
+                T value = first[i];
+                if (inclusive)
+                {
+                    acc = op(acc, value);
+                    out[i] = acc;
+                }
+                else
+                {
+                    out[i] = acc;
+                    acc = op(acc, value);
+                }
+            }
+        }
+    }, pool);
+    return out + n;
+}
+
+/*
+out[i] = first[0] op ... op first[i]
+*/
+template <typename InputIt, typename OutputIt, typename BinaryOp>
+inline OutputIt parallel_inclusive_scan(InputIt first, InputIt last, OutputIt out, BinaryOp op,
+                                        ThreadPool& pool = default_thread_pool())
+{
+    typedef typename std::iterator_traits<InputIt>::value_type T;
+    if (first == last)
+        return out;
+    //first element seeds the scan so op needs no identity value
+    T seed = first[0];
+    out[0] = seed;
+    return parallel_scan(first + 1, last, out + 1, seed, op, true, pool);
+}
+
+template <typename InputIt, typename OutputIt>
+inline OutputIt parallel_inclusive_scan(InputIt first, InputIt last, OutputIt out,
+                                        ThreadPool& pool = default_thread_pool())
+{
+    typedef typename std::iterator_traits<InputIt>::value_type T;
+    return parallel_inclusive_scan(first, last, out, std::plus<T>(), pool);
+}
+
+/*
+out[0] = init, out[i] = init op first[0] op ... op first[i-1]
+*/
+template <typename InputIt, typename OutputIt, typename T, typename BinaryOp>
+inline OutputIt parallel_exclusive_scan(InputIt first, InputIt last, OutputIt out, T init, BinaryOp op,
+                                        ThreadPool& pool = default_thread_pool())
+{
+    return parallel_scan(first, last, out, init, op, false, pool);
+}
+
+template <typename InputIt, typename OutputIt, typename T>
+inline OutputIt parallel_exclusive_scan(InputIt first, InputIt last, OutputIt out, T init,
+                                        ThreadPool& pool = default_thread_pool())
+{
+    return parallel_scan(first, last, out, init, std::plus<T>(), false, pool);
+}
+
+/*
+merge sorted [a, a_end) and [b, b_end) into out, big merges are split
+around the median of the larger input so both halves merge in parallel
+*/
+template <typename T, typename Compare>
+inline void parallel_merge(const T *a, const T *a_end, const T *b, const T *b_end,
+                           T *out, Compare comp, ThreadPool& pool)
+{
+    size_t a_len = a_end - a, b_len = b_end - b;
+    if (a_len + b_len <= PARALLEL_GRAIN || pool.size() == 1)
+    {
+        std::merge(a, a_end, b, b_end, out, comp);
+        return;
+    }
+    if (a_len < b_len)
+    {
+        //split b, elements of a equal to the pivot stay left of it (stability)
+        const T *b_mid = b + b_len / 2;
+        const T *a_mid = std::upper_bound(a, a_end, *b_mid, comp);
+        T *out_mid = out + (a_mid - a) + (b_mid - b);
+        TaskGroup group(pool);
+        group.run([=, &pool]() { parallel_merge(a, a_mid, b, b_mid, out, comp, pool); });
+        parallel_merge(a_mid, a_end, b_mid, b_end, out_mid, comp, pool);
+        group.wait();
+        return;
+    }
+    //split a, elements of b equal to the pivot go right of it (stability)
+    const T *a_mid = a + a_len / 2;
+    const T *b_mid = std::lower_bound(b, b_end, *a_mid, comp);
+    T *out_mid = out + (a_mid - a) + (b_mid - b);
+    TaskGroup group(pool);
+    group.run([=, &pool]() { parallel_merge(a, a_mid, b, b_mid, out, comp, pool); });
+    parallel_merge(a_mid, a_end, b_mid, b_end, out_mid, comp, pool);
+    group.wait();
+}
+
+/*
+stable parallel merge sort: every block is sorted by one task, then runs
+are merged pairwise with parallel_merge, ping-ponging with a temp buffer
+*/
+template <typename T, typename Compare>
+inline void parallel_merge_sort(T *first, T *last, Compare comp,
+                                ThreadPool& pool = default_thread_pool())
+{
+    size_t n = last - first;
+    if (n <= PARALLEL_GRAIN || pool.size() == 1)
+    {
+        std::stable_sort(first, last, comp);
+        return;
+    }
+
+    size_t blocks = parallel_block_count(n, PARALLEL_GRAIN, pool);
+    std::vector<size_t> bounds(blocks + 1);
+    for (size_t b = 0; b <= blocks; ++b)
+        bounds[b] = n * b / blocks;
+
+    parallel_for(0, blocks, 1, [first, comp, &bounds](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; ++b)
+            std::stable_sort(first + bounds[b], first + bounds[b + 1], comp);
+    }, pool);
+
+    T *temp = new T[n];
+    T *from = first, *to = temp;
+    while (bounds.size() > 2)
+    {
+        std::vector<size_t> merged;
+        TaskGroup group(pool);
+        size_t i = 0;
+        for (; i + 2 < bounds.size(); i += 2)
+        {
+            size_t lo = bounds[i], mid = bounds[i + 1], hi = bounds[i + 2];
+            merged.push_back(lo);
+            group.run([=, &pool]() {
+                parallel_merge(from + lo, from + mid, from + mid, from + hi, to + lo, comp, pool);
+            });
+        }
+        //odd run out is copied over unchanged
+        if (i + 1 < bounds.size())
+        {
+            merged.push_back(bounds[i]);
+            std::copy(from + bounds[i], from + bounds[i + 1], to + bounds[i]);
+        }
+        group.wait();
+        merged.push_back(n);
+        bounds.swap(merged);
+        std::swap(from, to);
+    }
+
+    if (from != first)
+        std::copy(from, from + n, first);
+    delete[] temp;
+}
+
+template <typename T>
+inline void parallel_merge_sort(T *first, T *last, ThreadPool& pool = default_thread_pool())
+{
+    parallel_merge_sort(first, last, std::less<T>(), pool);
+}
+
+/*
+LSD radix sort for int, 4 passes of 8 bits. The sign bit is flipped so
+negative values order before positive ones. Each pass counts digits per
+block in parallel, turns the (digit, block) counts into offsets with one
+serial scan and scatters every block in parallel, so the sort is stable
+and does O(n) work per pass
+*/
+inline void parallel_radix_sort(int *first, int *last, ThreadPool& pool = default_thread_pool())
+{
+    const unsigned int RADIX = 256;
+    size_t n = last - first;
+    if (n < 2)
+        return;
+
+    size_t blocks = parallel_block_count(n, PARALLEL_GRAIN, pool);
+    std::vector<size_t> count(blocks * RADIX);
+    unsigned int *from = (unsigned int*)first;
+    unsigned int *temp = new unsigned int[n];
+    unsigned int *to = temp;
+
+    for (unsigned int shift = 0; shift < 32; shift += 8)
+    {
+        std::fill(count.begin(), count.end(), 0);
+
+        parallel_for(0, blocks, 1, [=, &count](size_t lo, size_t hi) {
+            for (size_t b = lo; b < hi; ++b)
+            {
+                size_t *c = &count[b * RADIX];
+                for (size_t i = n * b / blocks; i < n * (b + 1) / blocks; ++i)
+                    c[((from[i] ^ 0x80000000u) >> shift) & 0xff]++;
+            }
+        }, pool);
+
+        //skip passes where every element has the same digit
+        bool trivial = false;
+        for (unsigned int d = 0; d < RADIX && !trivial; ++d)
+        {
+            size_t total = 0;
+            for (size_t b = 0; b < blocks; ++b)
+                total += count[b * RADIX + d];
+            trivial = total == n;
+        }
+        if (trivial)
+            continue;
+
+        size_t offset = 0;
+        for (unsigned int d = 0; d < RADIX; ++d)
+            for (size_t b = 0; b < blocks; ++b)
+            {
+                size_t c = count[b * RADIX + d];
+                count[b * RADIX + d] = offset;
+                offset += c;
+            }
+
+        parallel_for(0, blocks, 1, [=, &count](size_t lo, size_t hi) {
+            for (size_t b = lo; b < hi; ++b)
+            {
+                size_t *c = &count[b * RADIX];
+                for (size_t i = n * b / blocks; i < n * (b + 1) / blocks; ++i)
+                    to[c[((from[i] ^ 0x80000000u) >> shift) & 0xff]++] = from[i];
+            }
+        }, pool);
+        std::swap(from, to);
+    }
+
+    if (from != (unsigned int*)first)
+        std::copy(from, from + n, (unsigned int*)first);
+    delete[] temp;
+}
+
+#endif
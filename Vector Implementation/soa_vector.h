@@ -0,0 +1,292 @@
+#ifndef SOA_VECTOR_H
+#define SOA_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <utility>
+#include "vector.h"
+
+/*
+Structure of arrays vector
+SoAVector<int, double, int> stores records of (int, double, int) but keeps
+every field in its own contiguous array, all columns share one size and
+one capacity and grow together. A scan of one field reads only that field's
+array, a plain sequential stream the compiler can vectorize, instead of
+striding over whole records as an array of structs does.
+
+Growth follows Vector through the same helpers (vector.h): capacity is always
+a power of 2 and doubles when full. Vector itself only holds int, so columns
+are arrays of the field type managed the same way Vector manages its buffer.
+*/
+
+template <typename... Fields>
+class SoAVector
+{
+    typedef std::index_sequence_for<Fields...> Columns;
+
+    std::tuple<Fields*...> columns;
+    unsigned int _size;
+    unsigned int _capacity;
+
+    template <std::size_t... I> void allocate(unsigned int capacity, std::index_sequence<I...>);
+    template <std::size_t... I> void release(std::index_sequence<I...>);
+    template <std::size_t... I> void fill(unsigned int first, unsigned int last, std::index_sequence<I...>);
+    template <std::size_t... I> void store(unsigned int row, const Fields&... values, std::index_sequence<I...>);
+    template <std::size_t... I> std::tuple<Fields&...> row(unsigned int index, std::index_sequence<I...>);
+
+    SoAVector(const SoAVector&);
+    SoAVector& operator=(const SoAVector&);
+
+public:
+    template <std::size_t I> using field_type = typename std::tuple_element<I, std::tuple<Fields...> >::type;
+
+    SoAVector();
+    explicit SoAVector(unsigned int size);
+    void push_back(const Fields&... values);
+    void pop_back();
+    unsigned int size() const;
+    unsigned int capacity() const;
+    bool empty() const;
+    std::tuple<Fields&...> operator[](unsigned int index);
+    std::tuple<Fields&...> at(unsigned int index);
+    template <std::size_t I> field_type<I>& get(unsigned int index);
+    template <std::size_t I> field_type<I>* begin();
+    template <std::size_t I> field_type<I>* end();
+    void reserve(unsigned int capacity);
+    void resize(unsigned int size);
+    void clear();
+    ~SoAVector();
+};
+
+
+/*
+Default constructor, no column is allocated until the first push_back
+*/
+template <typename... Fields>
+inline SoAVector<Fields...>::SoAVector() : _size(0), _capacity(0)
+{
+    columns = std::tuple<Fields*...>(static_cast<Fields*>(NULL)...);
+}
+
+/*
+Parameterized constructor, it will allocate every column with
+next power of 2 of given size, elements are value initialized
+*/
+template <typename... Fields>
+inline SoAVector<Fields...>::SoAVector(unsigned int size) : _size(0), _capacity(0)
+{
+    columns = std::tuple<Fields*...>(static_cast<Fields*>(NULL)...);
+    resize(size);
+}
+
+/*
+allocate every column with given capacity and copy the first _size rows
+*/
+template <typename... Fields>
+template <std::size_t... I>
+inline void SoAVector<Fields...>::allocate(unsigned int capacity, std::index_sequence<I...>)
+{
+    std::tuple<Fields*...> fresh(new Fields[capacity]()...);
+
+    //copy column by column, each one a sequential stream
+    int expand[] = { 0, (std::copy(std::get<I>(columns), std::get<I>(columns) + _size,
+                                   std::get<I>(fresh)), 0)... };
+    (void)expand;
+
+    release(Columns());
+    columns = fresh;
+    _capacity = capacity;
+}
+
+/*
+delete every column
+*/
+template <typename... Fields>
+template <std::size_t... I>
+inline void SoAVector<Fields...>::release(std::index_sequence<I...>)
+{
+    int expand[] = { 0, (delete[] std::get<I>(columns), 0)... };
+    (void)expand;
+}
+
+/*
+value initialize rows [first, last) in each column
+*/
+template <typename... Fields>
+template <std::size_t... I>
+inline void SoAVector<Fields...>::fill(unsigned int first, unsigned int last, std::index_sequence<I...>)
+{
+    int expand[] = { 0, (std::fill(std::get<I>(columns) + first, std::get<I>(columns) + last, Fields()), 0)... };
+    (void)expand;
+}
+
+/*
+write one field of the row into each column
+*/
+template <typename... Fields>
+template <std::size_t... I>
+inline void SoAVector<Fields...>::store(unsigned int index, const Fields&... values, std::index_sequence<I...>)
+{
+    int expand[] = { 0, (std::get<I>(columns)[index] = values, 0)... };
+    (void)expand;
+}
+
+/*
+return references to every field of the row
+*/
+template <typename... Fields>
+template <std::size_t... I>
+inline std::tuple<Fields&...> SoAVector<Fields...>::row(unsigned int index, std::index_sequence<I...>)
+{
+    return std::tuple<Fields&...>(std::get<I>(columns)[index]...);
+}
+
+/*
+append one row, columns double in lockstep when full
+*/
+template <typename... Fields>
+inline void SoAVector<Fields...>::push_back(const Fields&... values)
+{
+    if (_size >= _capacity)
+        reserve(grown_capacity(_capacity));
+    store(_size++, values..., Columns());
+}
+
+/*
+it will decrease the size of the vector by 1
+if size <= 0 it will raised exception !
+*/
+template <typename... Fields>
+inline void SoAVector<Fields...>::pop_back()
+{
+    if (_size == 0)
+        throw std::string("vector is empty !");
+    _size--;
+}
+
+/*
+return no. of rows currently in the vector
+*/
+template <typename... Fields>
+inline unsigned int SoAVector<Fields...>::size() const
+{
+    return _size;
+}
+
+/*
+return no. of rows every column can hold, always power of 2
+*/
+template <typename... Fields>
+inline unsigned int SoAVector<Fields...>::capacity() const
+{
+    return _capacity;
+}
+
+//check where vector obj empty or not
+template <typename... Fields>
+inline bool SoAVector<Fields...>::empty() const
+{
+    return _size == 0;
+}
+
+/*
+return references to all fields of given row, unchecked like Vector::operator[]
+*/
+template <typename... Fields>
+inline std::tuple<Fields&...> SoAVector<Fields...>::operator[](unsigned int index)
+{
+    return row(index, Columns());
+}
+
+/*
+same as operator[] but raised index out of bound exception for invalid index
+*/
+template <typename... Fields>
+inline std::tuple<Fields&...> SoAVector<Fields...>::at(unsigned int index)
+{
+    if (index >= _size)
+        throw std::string("index larger than vector size !");
+    return row(index, Columns());
+}
+
+/*
+return reference of field I of given row
+*/
+template <typename... Fields>
+template <std::size_t I>
+inline typename SoAVector<Fields...>::template field_type<I>& SoAVector<Fields...>::get(unsigned int index)
+{
+    return std::get<I>(columns)[index];
+}
+
+/*
+return base address of column I, together with end<I>() it is a
+plain contiguous range usable with every algorithm working on Vector
+*/
+template <typename... Fields>
+template <std::size_t I>
+inline typename SoAVector<Fields...>::template field_type<I>* SoAVector<Fields...>::begin()
+{
+    return std::get<I>(columns);
+}
+
+/*
+return just next address of last element of column I
+*/
+template <typename... Fields>
+template <std::size_t I>
+inline typename SoAVector<Fields...>::template field_type<I>* SoAVector<Fields...>::end()
+{
+    return std::get<I>(columns) + _size;
+}
+
+/*
+reallocate every column with given capacity, same contract as
+Vector::reserve, reallocation happens only if capacity grows
+*/
+template <typename... Fields>
+inline void SoAVector<Fields...>::reserve(unsigned int capacity)
+{
+    if (capacity > _capacity)
+        allocate(capacity, Columns());
+}
+
+/*
+change no. of rows, capacity is rounded up to next power of 2.
+Rows added by growing the size are value initialized in every column,
+like Vector::resize, even when they were used before a shrink
+*/
+template <typename... Fields>
+inline void SoAVector<Fields...>::resize(unsigned int size)
+{
+    unsigned int old_size = _size;
+    reserve(1u << growth_factor(size));
+    if (size > old_size)
+        fill(old_size, size, Columns());
+    _size = size;
+}
+
+/*
+cleared the content of vector object and deleted every column, like Vector::clear
+*/
+template <typename... Fields>
+inline void SoAVector<Fields...>::clear()
+{
+    release(Columns());
+    columns = std::tuple<Fields*...>(static_cast<Fields*>(NULL)...);
+    _capacity = 0;
+    _size = 0;
+}
+
+/*
+destructor will delete every column
+*/
+template <typename... Fields>
+inline SoAVector<Fields...>::~SoAVector()
+{
+    release(Columns());
+}
+
+#endif
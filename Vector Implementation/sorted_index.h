@@ -0,0 +1,236 @@
+#ifndef SORTED_INDEX_H
+#define SORTED_INDEX_H
+
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "vector.h"
+
+/*
+Read only search index over a sorted Vector
+Binary search over begin()/end() halves the range per step, every step
+after the first few reads a different cache line and misses the cache.
+SortedIndex copies the sorted values into an implicit static B+ tree
+(S+ tree) of nodes of 16 ints, one 64 byte cache line each:
+
+leaves          - the sorted values in order, padded with INT_MAX to whole
+				  nodes, so a position in the leaves is the position in
+				  the Vector and lower_bound returns it directly
+internal layers - node k of a layer has children k * 17 ... k * 17 + 16 in
+				  the layer below, its key i is the smallest value of
+				  child i + 1. Layers are stored root first, so the top
+				  of the tree shares a few hot cache lines
+
+A lookup reads one cache line per layer, log17(n / 16) + 1 lines instead of
+log2(n). In a node the keys smaller than the query are counted with four
+SSE2 compares and a popcount, that count is the child to descend into, so
+there is no branch on the keys. Without SSE2 the count is a scalar loop.
+
+The batched lookups walk up to 16 queries down the tree together, one layer
+at a time, and prefetch every query's next node before the next layer, so
+the cache misses of different queries overlap instead of following each
+other. Sorted queries make neighbouring lookups share the top nodes.
+*/
+
+class SortedIndex
+{
+public:
+    enum { KEYS = 16, FANOUT = KEYS + 1, BATCH = 16 };
+
+private:
+    int *nodes;                         //all layers, KEYS ints per node, 64 byte aligned
+    std::vector<unsigned int> layer;    //first node of every layer, layer[0] the leaves
+    unsigned int _size;
+
+    static unsigned int rank(const int *node, int value);
+    const int* node(unsigned int level, unsigned int k) const;
+
+    SortedIndex(const SortedIndex&);
+    SortedIndex& operator=(const SortedIndex&);
+
+public:
+    explicit SortedIndex(Vector& sorted);
+    unsigned int lower_bound(int value) const;
+    bool contains(int value) const;
+    void lower_bound(const int *values, unsigned int count, unsigned int *out) const;
+    void contains(const int *values, unsigned int count, bool *out) const;
+    unsigned int size() const;
+    unsigned int bytes() const;
+    ~SortedIndex();
+};
+
+
+/*
+return no. of keys of the node smaller than value, keys are sorted so this
+is the index of the first key >= value
+*/
+inline unsigned int SortedIndex::rank(const int *node, int value)
+{
+#if defined(__SSE2__)
+    const __m128i *keys = (const __m128i*)node;
+    __m128i query = _mm_set1_epi32(value);
+    //every lane is -1 where key < value, narrowed to one byte per key
+    __m128i low = _mm_packs_epi32(_mm_cmpgt_epi32(query, _mm_load_si128(keys)),
+                                  _mm_cmpgt_epi32(query, _mm_load_si128(keys + 1)));
+    __m128i high = _mm_packs_epi32(_mm_cmpgt_epi32(query, _mm_load_si128(keys + 2)),
+                                   _mm_cmpgt_epi32(query, _mm_load_si128(keys + 3)));
+    return __builtin_popcount(_mm_movemask_epi8(_mm_packs_epi16(low, high)));
+#else
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < KEYS; ++i)
+        count += node[i] < value;
+    return count;
+#endif
+}
+
+/*
+return address of node k of given layer
+*/
+inline const int* SortedIndex::node(unsigned int level, unsigned int k) const
+{
+    return nodes + (size_t)(layer[level] + k) * KEYS;
+}
+
+/*
+build the index from a Vector sorted in ascending order, raised exception
+if out of memory. The Vector is only read, later changes of it are not seen
+*/
+inline SortedIndex::SortedIndex(Vector& sorted) : _size(sorted.size())
+{
+    //nodes per layer, leaves first, up to a single root
+    std::vector<unsigned int> count(1, _size == 0 ? 1 : (_size + KEYS - 1) / KEYS);
+    while (count.back() > 1)
+        count.push_back((count.back() + FANOUT - 1) / FANOUT);
+
+    unsigned int levels = count.size(), total = 0;
+    layer.resize(levels);
+    for (unsigned int h = levels; h-- > 0; )
+    {
+        layer[h] = total;
+        total += count[h];
+    }
+
+    nodes = (int*)aligned_alloc(64, (size_t)total * KEYS * sizeof(int));
+    if (nodes == NULL)
+        throw std::string("out of memory !");
+
+    int *leaves = nodes + (size_t)layer[0] * KEYS;
+    const int *values = sorted.begin();
+    for (unsigned int i = 0; i < count[0] * KEYS; ++i)
+        leaves[i] = i < _size ? values[i] : INT_MAX;
+
+    //key i of node k is the first leaf value of child i + 1, a missing child
+    //gets INT_MAX so no query descends into it
+    unsigned long long leaves_per_child = 1;
+    for (unsigned int h = 1; h < levels; ++h, leaves_per_child *= FANOUT)
+    {
+        int *level = nodes + (size_t)layer[h] * KEYS;
+        for (unsigned int k = 0; k < count[h]; ++k)
+            for (unsigned int i = 0; i < KEYS; ++i)
+            {
+                unsigned long long child = (unsigned long long)k * FANOUT + i + 1;
+                level[k * KEYS + i] = child < count[h - 1] ? leaves[child * leaves_per_child * KEYS] : INT_MAX;
+            }
+    }
+}
+
+/*
+return index of the first value >= given value in the sorted Vector, size()
+if there is none, the same as std::lower_bound(begin(), end(), value) - begin()
+*/
+inline unsigned int SortedIndex::lower_bound(int value) const
+{
+    unsigned int k = 0;
+    for (unsigned int h = layer.size() - 1; h > 0; --h)
+        k = k * FANOUT + rank(node(h, k), value);
+
+    unsigned int position = k * KEYS + rank(node(0, k), value);
+    return position < _size ? position : _size;
+}
+
+/*
+return true if value is in the sorted Vector
+*/
+inline bool SortedIndex::contains(int value) const
+{
+    unsigned int position = lower_bound(value);
+    return position < _size && nodes[(size_t)layer[0] * KEYS + position] == value;
+}
+
+/*
+out[i] = lower_bound(values[i]) for count values, BATCH lookups at a time
+descend together so their cache misses overlap
+*/
+inline void SortedIndex::lower_bound(const int *values, unsigned int count, unsigned int *out) const
+{
+    unsigned int k[BATCH];
+    for (unsigned int base = 0; base < count; base += BATCH)
+    {
+        unsigned int batch = count - base < BATCH ? count - base : (unsigned int)BATCH;
+        const int *query = values + base;
+        for (unsigned int j = 0; j < batch; ++j)
+            k[j] = 0;
+
+        for (unsigned int h = layer.size() - 1; h > 0; --h)
+            for (unsigned int j = 0; j < batch; ++j)
+            {
+                k[j] = k[j] * FANOUT + rank(node(h, k[j]), query[j]);
+                //loaded while the other queries of the batch take this layer
+                __builtin_prefetch(node(h - 1, k[j]));
+            }
+
+        for (unsigned int j = 0; j < batch; ++j)
+        {
+            unsigned int position = k[j] * KEYS + rank(node(0, k[j]), query[j]);
+            out[base + j] = position < _size ? position : _size;
+        }
+    }
+}
+
+/*
+out[i] = contains(values[i]) for count values, batched like lower_bound
+*/
+inline void SortedIndex::contains(const int *values, unsigned int count, bool *out) const
+{
+    unsigned int position[BATCH];
+    const int *leaves = nodes + (size_t)layer[0] * KEYS;
+    for (unsigned int base = 0; base < count; base += BATCH)
+    {
+        unsigned int batch = count - base < BATCH ? count - base : (unsigned int)BATCH;
+        lower_bound(values + base, batch, position);
+        for (unsigned int j = 0; j < batch; ++j)
+            out[base + j] = position[j] < _size && leaves[position[j]] == values[base + j];
+    }
+}
+
+/*
+return no. of values indexed
+*/
+inline unsigned int SortedIndex::size() const
+{
+    return _size;
+}
+
+/*
+return bytes of all nodes, leaves included
+*/
+inline unsigned int SortedIndex::bytes() const
+{
+    //leaves are the last layer, after every internal node
+    unsigned int leaves = _size == 0 ? 1 : (_size + KEYS - 1) / KEYS;
+    return (layer[0] + leaves) * KEYS * sizeof(int);
+}
+
+/*
+SortedIndex destructor, it will free the nodes
+*/
+inline SortedIndex::~SortedIndex()
+{
+    free(nodes);
+}
+
+#endif
@@ -0,0 +1,355 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <cstddef>
+#include <string>
+
+/*
+Int vector, array of int whose size is determined at run time.
+Storage grows in power of 2 so n push_back do O(log n) reallocations
+*/
+
+/*
+growth policy shared by Vector and SoAVector (soa_vector.h).
+return power of 2 exponent of the capacity for given size, i.e; ceil(log2(size)),
+computed with integer shifts so size 0 and 1 need no special case
+*/
+inline int growth_factor(unsigned int size)
+{
+    int f = 0;
+    while ((1ull << f) < size)
+        f++;
+    return f;
+}
+
+/*
+return capacity a full buffer of given capacity grows to on push_back,
+doubling keeps n push_back at O(log n) reallocations
+*/
+inline unsigned int grown_capacity(unsigned int capacity)
+{
+    return capacity == 0 ? 1 : capacity * 2;
+}
+
+class Vector
+{
+    int *buffer;
+    unsigned int _size;
+    unsigned int _capacity;
+    int factor;
+    //frees an adopted buffer, NULL for buffers from new int[]
+    void (*release)(int *storage, unsigned int capacity);
+
+    inline void free_buffer();
+
+public:
+	
+    inline Vector(); 
+    inline Vector(const unsigned int size);
+    inline Vector(const unsigned int size, int value);
+    inline void push_back(const int& value);
+    inline void pop_back();
+    inline unsigned int size() const;
+    inline unsigned int capacity() const;
+    inline int& front();
+    inline int& back();
+    inline int* begin();
+    inline int* end();
+    inline bool empty() const;
+    inline int& operator[](unsigned int index);
+    inline int& at(unsigned int index);
+    inline void reserve(unsigned int capacity);
+    inline void resize(unsigned int size);
+    inline void resize_uninitialized(unsigned int size);
+    inline void clear();
+    inline void swap(Vector& other);
+    inline void adopt(int *storage, unsigned int capacity, void (*release)(int *storage, unsigned int capacity));
+    inline ~Vector();   
+};
+
+
+/*
+Defalut contructor it will initialized 
+data member with default value
+*/
+inline Vector::Vector() 
+{
+   	buffer = NULL;
+   	_capacity = 0;
+   	_size = 0;
+   	factor = 0;
+   	release = NULL;
+}
+
+/*
+Parameterized contructor it will allocate memory  
+with next power of 2 of given size in buffered
+*/
+inline Vector::Vector(unsigned int size) 
+{
+   	_size = size;
+   	factor = growth_factor(size);
+   	_capacity = 1u << factor;
+   	buffer = new int[_capacity];
+   	release = NULL;
+}
+
+/*
+Parameterized contructor it will allocate memory  
+with next power of 2 of given size in buffred 
+and initialzed with given value 
+*/
+inline Vector::Vector(unsigned int size, int value) 
+{
+   	_size = size;
+   	factor = growth_factor(size);
+   	_capacity = 1u << factor;
+   	buffer = new int[_capacity];
+   	release = NULL;
+
+   	//initizing all memery with given value
+   	for(unsigned int i=0;i<_size;++i)
+   		buffer[i] = value;
+}
+
+/*
+First it will check free space, if available it will insert value 
+othereise it will double the size of buffer then insert value 
+*/
+inline void Vector::push_back(const int& value) 
+{
+    /*
+        buffer will grow in double the size as needed.
+        This is so that if we are inserting n items at most only O(log n) regrowths are performed
+        and at most O(n) space is wasted.
+    */
+    if (_size >= _capacity) 
+    {
+        //reserve space by double if buffer is full  
+        reserve(grown_capacity(_capacity));
+    }
+    buffer [_size++] = value;
+}
+
+/*
+it will decrease the sise of the vector by 1
+if size <= 0 it will raised exception !
+*/
+inline void Vector::pop_back() 
+{
+	//if there is not any element to pop_back raised exception
+	if(_size <= 0)
+		throw std::string("vector is empty !");
+	else
+		_size--;	
+}
+
+
+/*
+return reference of first element, raised exception if vector is empty
+*/
+inline int& Vector::front() 
+{
+
+	//if there is not any element to pop_back raised exception
+	if(_size <= 0)
+		std::string("vector is empty !");
+	
+	return buffer[0];
+}
+
+/*
+return reference of last element
+*/
+inline int& Vector::back() 
+{
+    return buffer[_size - 1];
+}
+
+/*
+return base address of the vector
+*/
+inline int* Vector::begin() 
+{
+    return buffer;
+}
+
+/*
+return just next address of last element of the vector   
+*/
+inline int* Vector::end() 
+{
+    return (buffer + _size);
+}
+
+/*
+return size of vector i.e; no. of element 
+currently in the vector
+*/
+inline unsigned int Vector::size() const 
+{
+    return _size;
+} 
+
+/*
+It will give the maximum size of vector that has been 
+allocated till now, In this implementation it always power of 2
+*/
+inline unsigned int Vector::capacity() const 
+{
+    return _capacity;
+}
+
+/*
+Overloading subs script operator([]) that will return 
+reference of the element on given index. It does no bounds check so 
+loops over the vector inline and vectorize like loops over a plain array, 
+use at() for checked access. Build with -DVECTOR_BOUNDS_CHECK (debug builds) 
+to make operator[] check the index as well
+*/
+inline int& Vector::operator[](unsigned int index) 
+{
+#ifdef VECTOR_BOUNDS_CHECK
+	return at(index);
+#else
+	return buffer[index];
+#endif
+}
+
+/*
+return reference of the element on given index, 
+raised index out of bound exception for invalid index 
+*/
+inline int& Vector::at(unsigned int index) 
+{
+	//index is unsigned so only upper bound has to be checked
+	if(index >= _size)
+		throw std::string("index larger than vector size !");
+
+	return buffer[index];
+}
+
+//check where vector obj empty or not 
+inline bool Vector:: empty() const 
+{
+   	return _size == 0;
+}
+
+/*
+It informs the vector of a planned change in size. 
+This enables the vector to manage the storage allocation accordingly. 
+reserve does not change the size of the vector and reallocation happens 
+if and only if the current capacity is less than the argument of reserve
+*/
+inline void Vector::reserve(unsigned int capacity) 
+{
+    if (capacity <= _capacity)
+        return;
+
+    int * newBuffer = new int[capacity];
+
+    for (unsigned int i = 0; i < _size; i++)
+        newBuffer[i] = buffer[i];
+
+    free_buffer();
+    _capacity = capacity;
+    factor = growth_factor(capacity);
+    buffer = newBuffer;
+    release = NULL;
+}
+
+/*
+It informs the vector of a planned change in size. 
+Elements added by growing the size are set to 0
+*/
+inline void Vector::resize(unsigned int size) 
+{
+    unsigned int old_size = _size;
+    resize_uninitialized(size);
+    for (unsigned int i = old_size; i < size; i++)
+        buffer[i] = 0;
+}
+
+/*
+same as resize but elements added by growing the size are left uninitialized,
+for callers that write every new element anyway (e.g; bulk loaders), so
+no element is written twice
+*/
+inline void Vector::resize_uninitialized(unsigned int size) 
+{
+    reserve(1u << growth_factor(size));
+    _size = size;
+}
+
+/*
+cleared the content vector object 
+*/
+inline void Vector::clear() 
+{
+    free_buffer();
+    _capacity = 0;
+    _size = 0;
+    buffer = NULL;
+    factor = 0;
+    release = NULL;
+}
+
+/*
+exchange content of both vectors, no element is copied
+*/
+inline void Vector::swap(Vector& other) 
+{
+    int *other_buffer = other.buffer;
+    unsigned int other_size = other._size, other_capacity = other._capacity;
+    int other_factor = other.factor;
+    void (*other_release)(int*, unsigned int) = other.release;
+
+    other.buffer = buffer;
+    other._size = _size;
+    other._capacity = _capacity;
+    other.factor = factor;
+    other.release = release;
+
+    buffer = other_buffer;
+    _size = other_size;
+    _capacity = other_capacity;
+    factor = other_factor;
+    release = other_release;
+}
+
+/*
+take over storage of given capacity allocated by other means than new int[]
+(e.g; mmap for pages nobody wrote yet), release frees it once the vector
+no longer needs it. Content is dropped, size is 0
+*/
+inline void Vector::adopt(int *storage, unsigned int capacity, void (*release)(int *storage, unsigned int capacity)) 
+{
+    free_buffer();
+    buffer = storage;
+    _size = 0;
+    _capacity = capacity;
+    factor = growth_factor(capacity);
+    this->release = release;
+}
+
+/*
+free the buffer with release if it was adopted, delete[] otherwise
+*/
+inline void Vector::free_buffer() 
+{
+    if (release != NULL)
+        release(buffer, _capacity);
+    else
+        delete[] buffer;
+}
+
+/*
+vector destructor automatically called when object will go out of scope
+it will delete memory reserved by object
+*/
+inline Vector::~Vector() 
+{
+    free_buffer();
+}
+
+#endif
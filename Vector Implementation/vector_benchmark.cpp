@@ -0,0 +1,699 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <new>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "vector.h"
+#include "soa_vector.h"
+#include "packed_vector.h"
+#include "vector_loader.h"
+#include "vector_numa.h"
+#include "sorted_index.h"
+#include "concurrent_vector.h"
+
+using namespace std;
+
+/*
+Vector benchmark
+Compare Vector against std::vector for push_back, reserve + push_back,
+resize, the two sized constructors and sequential and random reads at
+element counts 10, 100, ... up to given maximum. Every case runs in its own
+forked process so it reports its own ns per element, no. of allocations
+of one run and peak RSS growth, without memory left over from earlier cases.
+
+Then measure tight loops over Vector with checked (at()) and unchecked (operator[])
+access against the same loops over a plain array, and a one field scan
+over an array of structs against the same scan over SoAVector, and a scan
+of sorted ids stored in Vector against the same ids in PackedVector.
+Then look up random values in a sorted Vector with binary search against
+SortedIndex (sorted_index.h), one by one and batched.
+Then load a text file of integers with fscanf and push_back against
+the parallel bulk loader of vector_loader.h.
+Then append from 1, 2, 4 and 8 threads at once into ConcurrentVector
+against a Vector behind a mutex.
+Last, build a Vector with Vector(size, value), spread over the nodes block by block,
+interleaved and bound to node 0 (vector_numa.h) and time building it and a
+parallel sum over it, on a multi socket machine the sum shows remote reads.
+
+To compile this program run below cmd
+g++ -O3 vector_benchmark.cpp -lpthread -o vector_benchmark
+
+To see which loops the compiler vectorized add -fopt-info-vec-optimized.
+Every operator[] loop is reported as vectorized (the gather loop needs
+-mavx2 for its gather instruction). The at() loops are only vectorized
+when the compiler can prove the check redundant (i < size()), the gather
+loop reads index from another Vector so at() has to check, and possibly
+throw, on every iteration and stays scalar.
+
+To run this program run below cmd
+./vector_benchmark [max elements of comparison, e.g. 1000000000] [elements of loop benchmarks]
+*/
+
+//no. of calls to operator new / new[], counted to report allocations per case,
+//atomic as ThreadPool workers and appender threads allocate too
+static std::atomic<unsigned long long> allocation_count(0);
+
+//count one allocation and take it from malloc, every operator delete frees with free
+static void* counted_malloc(size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(size == 0 ? 1 : size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size)
+{
+	return counted_malloc(size);
+}
+
+void* operator new[](size_t size)
+{
+	return counted_malloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+/*
+ * Function: now_ns()
+ *
+ * Purpose: monotonic clock in nano seconds
+ *
+ * Returns: current time
+ */
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Function: report()
+ *
+ * Purpose: print one result line as ns per element
+ *
+ * Arguments: name - benchmark name, ns - total time, n - elements, checksum - result of the loop
+ */
+static void report(const string& name, double ns, unsigned int n, long long checksum)
+{
+	cout<<left<<setw(28)<<name<<right<<setw(10)<<fixed<<setprecision(3)
+	    <<ns / n<<" ns/op   checksum "<<checksum<<endl;
+}
+
+/*
+result of one comparison case sent from the forked child to the parent
+*/
+struct CaseResult
+{
+	int ok;
+	double ns_per_op;
+	unsigned long long allocations;
+	long peak_rss_kb;
+	long long checksum;
+};
+
+/*
+ * Function: run_case()
+ *
+ * Purpose: run one case in a forked child. prepare(n) builds the input outside
+ *			the timed region, body(container, n) is timed and repeated until
+ *			it ran for at least 100 ms. Allocations are those of the first run,
+ *			peak RSS is the child's maximum resident size minus its size before the case
+ *
+ * Arguments: container - container name, operation - case name, n - no. of elements
+ *
+ * Returns: void, prints one result line
+ */
+template <typename Container, typename Prepare, typename Body>
+static void run_case(const string& container, const string& operation, unsigned int n,
+                     Prepare prepare, Body body)
+{
+	int fd[2];
+	if (pipe(fd) != 0)
+		return;
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		close(fd[0]);
+		CaseResult result = { 0, 0, 0, 0, 0 };
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		long baseline_kb = usage.ru_maxrss;
+
+		try
+		{
+			double total = 0;
+			unsigned long long runs = 0;
+			while (total < 1e8)
+			{
+				Container *input = prepare(n);
+				unsigned long long before = allocation_count.load(std::memory_order_relaxed);
+				double start = now_ns();
+				result.checksum += body(input, n);
+				total += now_ns() - start;
+				if (runs++ == 0)
+					result.allocations = allocation_count.load(std::memory_order_relaxed) - before;
+				delete input;
+			}
+			getrusage(RUSAGE_SELF, &usage);
+			result.ok = 1;
+			result.ns_per_op = total / runs / (n ? n : 1);
+			result.peak_rss_kb = usage.ru_maxrss - baseline_kb;
+		}
+		catch(...)
+		{
+		}
+
+		if (write(fd[1], &result, sizeof(result)) != sizeof(result))
+			_exit(1);
+		_exit(0);
+	}
+
+	close(fd[1]);
+	CaseResult result = { 0, 0, 0, 0, 0 };
+	ssize_t got = pid > 0 ? read(fd[0], &result, sizeof(result)) : -1;
+	close(fd[0]);
+	if (pid > 0)
+		waitpid(pid, NULL, 0);
+
+	cout<<left<<setw(12)<<container<<setw(22)<<operation<<right<<setw(11)<<n;
+	//child killed (e.g. out of memory) or threw
+	if (got != (ssize_t)sizeof(result) || !result.ok)
+	{
+		cout<<"      failed"<<endl;
+		return;
+	}
+	cout<<fixed<<setprecision(3)<<setw(12)<<result.ns_per_op<<" ns/op"
+	    <<setw(8)<<result.allocations<<" allocs"
+	    <<setw(12)<<result.peak_rss_kb<<" KB peak RSS"<<endl;
+}
+
+//make the compiler assume memory behind p is read, so stores into a
+//container that is destroyed right after are not removed as dead
+static inline void escape(void *p)
+{
+	asm volatile("" : : "g"(p) : "memory");
+}
+
+//input of cases that build their own container
+template <typename Container>
+static Container* prepare_nothing(unsigned int)
+{
+	return NULL;
+}
+
+//input of read cases, container of n elements
+template <typename Container>
+static Container* prepare_filled(unsigned int n)
+{
+	return new Container(n, 1);
+}
+
+template <typename Container>
+static long long push_back_case(Container*, unsigned int n)
+{
+	Container c;
+	for(unsigned int i=0;i < n;++i)
+		c.push_back(i);
+	escape(&c[0]);
+	return c.size();
+}
+
+template <typename Container>
+static long long reserve_push_back_case(Container*, unsigned int n)
+{
+	Container c;
+	c.reserve(n);
+	for(unsigned int i=0;i < n;++i)
+		c.push_back(i);
+	escape(&c[0]);
+	return c.size();
+}
+
+template <typename Container>
+static long long resize_case(Container*, unsigned int n)
+{
+	Container c;
+	c.resize(n);
+	escape(&c[0]);
+	return c.size();
+}
+
+template <typename Container>
+static long long construct_case(Container*, unsigned int n)
+{
+	Container c(n);
+	escape(&c[0]);
+	return c.size();
+}
+
+template <typename Container>
+static long long construct_value_case(Container*, unsigned int n)
+{
+	Container c(n, 7);
+	escape(&c[0]);
+	return c.size();
+}
+
+template <typename Container>
+static long long sequential_read_case(Container *c, unsigned int n)
+{
+	long long sum = 0;
+	for(unsigned int i=0;i < n;++i)
+		sum += (*c)[i];
+	return sum;
+}
+
+//reads n elements at pseudo random positions, multiply-shift maps the hash into [0, n)
+template <typename Container>
+static long long random_read_case(Container *c, unsigned int n)
+{
+	long long sum = 0;
+	unsigned int x = 12345;
+	for(unsigned int i=0;i < n;++i)
+	{
+		x = x * 2654435761u + 1;
+		sum += (*c)[(unsigned int)(((unsigned long long)x * n) >> 32)];
+	}
+	return sum;
+}
+
+/*
+ * Function: run_container_suite()
+ *
+ * Purpose: run every comparison case for one container at n elements
+ *
+ * Arguments: name - container name in the report, n - element count
+ */
+template <typename Container>
+static void run_container_suite(const string& name, unsigned int n)
+{
+	run_case<Container>(name, "push_back", n, prepare_nothing<Container>, push_back_case<Container>);
+	run_case<Container>(name, "reserve + push_back", n, prepare_nothing<Container>, reserve_push_back_case<Container>);
+	run_case<Container>(name, "resize", n, prepare_nothing<Container>, resize_case<Container>);
+	run_case<Container>(name, "construct(n)", n, prepare_nothing<Container>, construct_case<Container>);
+	run_case<Container>(name, "construct(n, value)", n, prepare_nothing<Container>, construct_value_case<Container>);
+	run_case<Container>(name, "sequential read", n, prepare_filled<Container>, sequential_read_case<Container>);
+	run_case<Container>(name, "random read", n, prepare_filled<Container>, random_read_case<Container>);
+}
+
+/*
+ * Function: run_suite()
+ *
+ * Purpose: run every comparison case for Vector and std::vector at
+ *			10, 100, ... max_n elements
+ *
+ * Arguments: max_n - largest element count
+ */
+static void run_suite(unsigned int max_n)
+{
+	cout<<"<<---------- Vector vs std::vector, up to "<<max_n<<" elements ---------->>"<<endl;
+	for(unsigned long long n=10;n <= max_n;n *= 10)
+	{
+		run_container_suite<Vector>("Vector", n);
+		run_container_suite<std::vector<int> >("std::vector", n);
+	}
+}
+
+//sum with unchecked operator[]
+static long long sum_unchecked(Vector& v)
+{
+	long long sum = 0;
+	for(unsigned int i=0;i < v.size();++i)
+		sum += v[i];
+	return sum;
+}
+
+//sum with checked at()
+static long long sum_checked(Vector& v)
+{
+	long long sum = 0;
+	for(unsigned int i=0;i < v.size();++i)
+		sum += v.at(i);
+	return sum;
+}
+
+//sum over begin()/end() pointers
+static long long sum_iterator(Vector& v)
+{
+	long long sum = 0;
+	for(int *it = v.begin();it != v.end();++it)
+		sum += *it;
+	return sum;
+}
+
+//sum over a plain array, the baseline
+static long long sum_array(const int *a, unsigned int n)
+{
+	long long sum = 0;
+	for(unsigned int i=0;i < n;++i)
+		sum += a[i];
+	return sum;
+}
+
+//element wise a[i] = a[i] * 2 - 1 with unchecked operator[]
+static void scale_unchecked(Vector& v)
+{
+	for(unsigned int i=0;i < v.size();++i)
+		v[i] = v[i] * 2 - 1;
+}
+
+//element wise a[i] = a[i] * 2 - 1 with checked at()
+static void scale_checked(Vector& v)
+{
+	for(unsigned int i=0;i < v.size();++i)
+		v.at(i) = v.at(i) * 2 - 1;
+}
+
+//sum of v[index[i]] with unchecked operator[]
+static long long gather_unchecked(Vector& v, Vector& index)
+{
+	long long sum = 0;
+	for(unsigned int i=0;i < index.size();++i)
+		sum += v[index[i]];
+	return sum;
+}
+
+//sum of v[index[i]] with checked at()
+static long long gather_checked(Vector& v, Vector& index)
+{
+	long long sum = 0;
+	for(unsigned int i=0;i < index.size();++i)
+		sum += v.at(index[i]);
+	return sum;
+}
+
+//record stored as array of structs for the layout benchmark
+struct Record
+{
+	int id;
+	double price;
+	int quantity;
+	long long timestamp;
+};
+
+//sum of one field over array of structs, strides over the whole record
+static long long sum_quantity_aos(const Record *records, unsigned int n)
+{
+	long long sum = 0;
+	for(unsigned int i=0;i < n;++i)
+		sum += records[i].quantity;
+	return sum;
+}
+
+//sum of one column of structure of arrays, plain sequential stream
+static long long sum_quantity_soa(SoAVector<int, double, int, long long>& records)
+{
+	long long sum = 0;
+	for(int *q = records.begin<2>();q != records.end<2>();++q)
+		sum += *q;
+	return sum;
+}
+
+//sum of PackedVector, decoded one block at a time
+static long long sum_packed(const PackedVector& packed)
+{
+	long long sum = 0;
+	int block[PackedVector::BLOCK];
+	unsigned int blocks = (packed.size() + PackedVector::BLOCK - 1) / PackedVector::BLOCK;
+	for(unsigned int b=0;b < blocks;++b)
+	{
+		unsigned int count = packed.decode_block(b, block);
+		for(unsigned int i=0;i < count;++i)
+			sum += block[i];
+	}
+	return sum;
+}
+
+/*
+one appending thread of the append benchmark, pushes count values into
+either the ConcurrentVector or the mutex protected Vector
+*/
+struct Appender
+{
+	ConcurrentVector *concurrent;
+	Vector *locked;
+	pthread_mutex_t *lock;
+	unsigned int count;
+};
+
+static void* append_concurrent(void *arg)
+{
+	Appender *a = (Appender*)arg;
+	for(unsigned int i=0;i < a->count;++i)
+		a->concurrent->push_back((int)i);
+	return NULL;
+}
+
+static void* append_locked(void *arg)
+{
+	Appender *a = (Appender*)arg;
+	for(unsigned int i=0;i < a->count;++i)
+	{
+		pthread_mutex_lock(a->lock);
+		a->locked->push_back((int)i);
+		pthread_mutex_unlock(a->lock);
+	}
+	return NULL;
+}
+
+/*
+ * Function: run_appenders()
+ *
+ * Purpose: start threads appenders running fn, each pushing n / threads values, and wait for them
+ *
+ * Arguments: a - appender shared by all threads, fn - thread function, threads - no. of threads, n - total values
+ *
+ * Returns: wall time in nano seconds
+ */
+static double run_appenders(Appender a, void* (*fn)(void*), unsigned int threads, unsigned int n)
+{
+	vector<pthread_t> tids(threads);
+	a.count = n / threads;
+	double start = now_ns();
+	for(unsigned int t=0;t < threads;++t)
+		pthread_create(&tids[t], NULL, fn, &a);
+	for(unsigned int t=0;t < threads;++t)
+		pthread_join(tids[t], NULL);
+	return now_ns() - start;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+	unsigned int n = argc > 2 ? strtoul(argv[2], NULL, 10) : (max_n < 10000000 ? max_n : 10000000);
+	int rounds = 10;
+
+	run_suite(max_n);
+
+	Vector vec(n, 1);
+	Vector index(n);
+	std::vector<int> array(n, 1);
+
+	//index walks the vector with a large odd stride so every element is visited once
+	for(unsigned int i=0;i < n;++i)
+		index[i] = (unsigned int)(((unsigned long long)i * 7919) % n);
+
+	double start;
+	long long checksum;
+
+	cout<<"<<---------- Access benchmark, "<<n<<" elements ---------->>"<<endl;
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += sum_array(&array[0], n);
+	report("sum plain array", (now_ns() - start) / rounds, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += sum_unchecked(vec);
+	report("sum Vector operator[]", (now_ns() - start) / rounds, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += sum_iterator(vec);
+	report("sum Vector begin()/end()", (now_ns() - start) / rounds, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += sum_checked(vec);
+	report("sum Vector at()", (now_ns() - start) / rounds, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += gather_unchecked(vec, index);
+	report("gather Vector operator[]", (now_ns() - start) / rounds, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += gather_checked(vec, index);
+	report("gather Vector at()", (now_ns() - start) / rounds, n, checksum);
+
+	start = now_ns();
+	for(int r=0;r<rounds;++r) scale_unchecked(vec);
+	report("scale Vector operator[]", (now_ns() - start) / rounds, n, sum_unchecked(vec));
+
+	start = now_ns();
+	for(int r=0;r<rounds;++r) scale_checked(vec);
+	report("scale Vector at()", (now_ns() - start) / rounds, n, sum_unchecked(vec));
+
+	std::vector<Record> aos(n);
+	SoAVector<int, double, int, long long> soa;
+	for(unsigned int i=0;i < n;++i)
+	{
+		Record r = { (int)i, i * 0.5, (int)(i % 7), (long long)i * 1000 };
+		aos[i] = r;
+		soa.push_back(r.id, r.price, r.quantity, r.timestamp);
+	}
+
+	cout<<"<<---------- Layout benchmark, "<<n<<" records ---------->>"<<endl;
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += sum_quantity_aos(&aos[0], n);
+	report("one field, array of structs", (now_ns() - start) / rounds, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += sum_quantity_soa(soa);
+	report("one field, SoAVector column", (now_ns() - start) / rounds, n, checksum);
+
+	Vector ids(n);
+	int id = 0;
+	for(unsigned int i=0;i < n;++i)
+		ids[i] = id += 1 + i % 13;
+	PackedVector packed(ids);
+
+	cout<<"<<---------- Compression benchmark, "<<n<<" sorted ids, "<<ids.size() * sizeof(int)
+	    <<" bytes packed into "<<packed.bytes()<<" bytes ---------->>"<<endl;
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += sum_unchecked(ids);
+	report("scan Vector", (now_ns() - start) / rounds, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	for(int r=0;r<rounds;++r) checksum += sum_packed(packed);
+	report("scan PackedVector", (now_ns() - start) / rounds, n, checksum);
+
+	Vector sorted(n);
+	for(unsigned int i=0;i < n;++i)
+		sorted[i] = (int)(i * 2);
+	SortedIndex search_index(sorted);
+	Vector lookups(n);
+	for(unsigned int i=0;i < n;++i)
+		lookups[i] = (int)((i * 2654435761u) % (2 * n));
+	std::vector<unsigned int> positions(n);
+
+	cout<<"<<---------- Search benchmark, "<<n<<" lookups in "<<n<<" sorted values, index "
+	    <<search_index.bytes()<<" bytes ---------->>"<<endl;
+
+	start = now_ns(); checksum = 0;
+	for(unsigned int i=0;i < n;++i)
+		checksum += std::lower_bound(sorted.begin(), sorted.end(), lookups[i]) - sorted.begin();
+	report("binary search", now_ns() - start, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	for(unsigned int i=0;i < n;++i)
+		checksum += search_index.lower_bound(lookups[i]);
+	report("SortedIndex", now_ns() - start, n, checksum);
+
+	start = now_ns(); checksum = 0;
+	search_index.lower_bound(lookups.begin(), n, &positions[0]);
+	for(unsigned int i=0;i < n;++i)
+		checksum += positions[i];
+	report("SortedIndex batched", now_ns() - start, n, checksum);
+
+	char path[] = "/tmp/vector_benchmark_XXXXXX";
+	FILE *file = fdopen(mkstemp(path), "w");
+	for(unsigned int i=0;i < n;++i)
+		fprintf(file, "%d\n", (int)(i * 2654435761u));
+	long long file_bytes = ftell(file);
+	fclose(file);
+
+	cout<<"<<---------- Load benchmark, "<<n<<" integers, "<<file_bytes<<" bytes of text ---------->>"<<endl;
+
+	start = now_ns();
+	Vector scanned;
+	file = fopen(path, "r");
+	int value;
+	while (fscanf(file, "%d", &value) == 1)
+		scanned.push_back(value);
+	fclose(file);
+	double ns = now_ns() - start;
+	report("fscanf + push_back", ns, n, sum_unchecked(scanned));
+	cout<<"                            "<<setw(10)<<file_bytes / ns * 1000<<" MB/s"<<endl;
+
+	start = now_ns();
+	Vector loaded;
+	load_vector(path, loaded);
+	ns = now_ns() - start;
+	report("load_vector", ns, n, sum_unchecked(loaded));
+	cout<<"                            "<<setw(10)<<file_bytes / ns * 1000<<" MB/s"<<endl;
+	remove(path);
+
+	cout<<"<<---------- Append benchmark, "<<n<<" push_backs from several threads ---------->>"<<endl;
+
+	pthread_mutex_t append_lock = PTHREAD_MUTEX_INITIALIZER;
+	for(unsigned int threads=1;threads <= 8;threads *= 2)
+	{
+		ConcurrentVector concurrent;
+		Appender a = { &concurrent, NULL, NULL, 0 };
+		ns = run_appenders(a, append_concurrent, threads, n);
+		report("ConcurrentVector, " + to_string(threads) + " threads", ns, n, concurrent.size());
+
+		Vector locked;
+		Appender b = { NULL, &locked, &append_lock, 0 };
+		ns = run_appenders(b, append_locked, threads, n);
+		report("mutex + Vector, " + to_string(threads) + " threads", ns, n, locked.size());
+	}
+
+	cout<<"<<---------- Placement benchmark, "<<n<<" elements, "<<numa_node_count()<<" NUMA node(s) ---------->>"<<endl;
+
+	const char *placement_name[] = { "serial", "spread", "interleave", "bind node 0" };
+	for(int p=0;p < 4;++p)
+	{
+		start = now_ns();
+		Vector placed;
+		if (p == 0)
+		{
+			Vector serial(n, 1);
+			placed.swap(serial);
+		}
+		else
+			numa_resize(placed, n, 1, (NumaPolicy)(p - 1), 0);
+		report(string("build, ") + placement_name[p], now_ns() - start, n, placed.size());
+
+		start = now_ns(); checksum = 0;
+		for(int r=0;r<rounds;++r) checksum += parallel_reduce(placed.begin(), placed.end(), 0LL);
+		report(string("parallel sum, ") + placement_name[p], (now_ns() - start) / rounds, n, checksum);
+
+		vector<unsigned long> pages = numa_page_nodes(placed);
+		cout<<"                            pages per node :";
+		for(unsigned int i=0;i + 1 < pages.size();++i)
+			cout<<" "<<pages[i];
+		cout<<endl;
+	}
+
+	return 0;
+}
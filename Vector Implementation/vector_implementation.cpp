@@ -1,9 +1,19 @@
 #include <iostream>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>     
 #include <ctime> 
 #include <climits>
 #include <ctime>
+#include <pthread.h>
+#include "vector.h"
+#include "concurrent_vector.h"
+#include "parallel_algorithms.h"
+#include "soa_vector.h"
+#include "packed_vector.h"
+#include "vector_loader.h"
+#include "vector_numa.h"
+#include "sorted_index.h"
 
 using namespace std;
 
@@ -12,243 +22,37 @@ using namespace std;
 C arrays have size determined at compile time. Implement a C++ class that provides you with objects
 that behave like arrays of int except that their size is determined at run time. Explain the reasons for
 your design decisions.
-*/
-
-class Vector
-{
-    int *buffer;
-    unsigned int _size;
-    unsigned int _capacity;
-    int factor;
-
-public:
-	
-    inline Vector(); 
-    inline Vector(const unsigned int size);
-    inline Vector(const unsigned int size, int value);
-    void push_back(const int& value);
-    inline void pop_back();
-    inline unsigned int size() const;
-    inline unsigned int capacity() const;
-    inline int& front();
-    inline int& back();
-    inline int* begin();
-    inline int* end();
-    inline bool empty() const;
-    int& operator[](unsigned int index);
-    void reserve(unsigned int capacity);
-    void resize(unsigned int size);
-    inline void clear();
-    inline ~Vector();   
-};
-
-
-/*
-Defalut contructor it will initialized 
-data member with default value
-*/
-Vector::Vector() 
-{
-   	buffer = NULL;
-   	_capacity = 0;
-   	_size = 0;
-   	factor = 0;
-}
-
-/*
-Parameterized contructor it will allocate memory  
-with next power of 2 of given size in buffered
-*/
-Vector:: Vector(unsigned int size) 
-{
-   	_size = size;
-   	factor = ceil(log((double) size) / log(2.0));
-   	_capacity = 1 << factor;
-   	buffer = new int[_capacity];
-}
-
-/*
-Parameterized contructor it will allocate memory  
-with next power of 2 of given size in buffred 
-and initialzed with given value 
-*/
-Vector:: Vector(unsigned int size, int value) 
-{
-   	_size = size;
-   	factor = ceil(log((double) size) / log(2.0));
-   	_capacity = 1 << factor;
-   	buffer = new int[_capacity];
-
-   	//initizing all memery with given value
-   	for(unsigned int i=0;i<_size;++i)
-   		buffer[i] = value;
-}
-
-/*
-First it will check free space, if available it will insert value 
-othereise it will double the size of buffer then insert value 
-*/
-void Vector::push_back(const int& value) 
-{
-    /*
-        buffer will grow in double the size as needed.
-        This is so that if we are inserting n items at most only O(log n) regrowths are performed
-        and at most O(n) space is wasted.
-    */
-    if (_size >= _capacity) 
-    {
-        //reserve space by double if buffer is full  
-        reserve(1 << factor);
-        factor++;
-    }
-    buffer [_size++] = value;
-}
-
-/*
-it will decrease the sise of the vector by 1
-if size <= 0 it will raised exception !
-*/
-inline void Vector::pop_back() 
-{
-	//if there is not any element to pop_back raised exception
-	if(_size <= 0)
-		throw string("vector is empty !");
-	else
-		_size--;	
-}
-
-
-/*
-return reference of first element, raised exception if vector is empty
-*/
-inline int& Vector::front() 
-{
-
-	//if there is not any element to pop_back raised exception
-	if(_size <= 0)
-		string("vector is empty !");
-	
-	return buffer[0];
-}
 
-/*
-return reference of last element
+Vector class lives in vector.h so other programs (benchmarks) can share it
 */
-inline int& Vector::back() 
-{
-    return buffer[_size - 1];
-}
 
 /*
-return base address of the vector
+thread function for test case 3, it will push back 0 to 9999
+into the concurrent vector passed as argument
 */
-inline int* Vector::begin() 
+void* appender_thread(void *arg)
 {
-    return buffer;
-}
+	ConcurrentVector *vec = (ConcurrentVector*)arg;
 
-/*
-return just next address of last element of the vector   
-*/
-inline int* Vector::end() 
-{
-    return (buffer + _size);
-}
-
-/*
-return size of vector i.e; no. of element 
-currently in the vector
-*/
-inline unsigned int Vector::size() const 
-{
-    return _size;
-} 
-
-/*
-It will give the maximum size of vector that has been 
-allocated till now, In this implementation it always power of 2
-*/
-inline unsigned int Vector::capacity() const 
-{
-    return _capacity;
-}
+	for(int i=0;i<10000;++i)
+		vec->push_back(i);
 
-/*
-Overloading subs script operator([]) that will return 
-reference of the element on given index, 
-raised index out of bound exception for invalid index 
-*/
-inline int& Vector::operator[](unsigned int index) 
-{
-    
-    //if index less than 0
-	if(index < 0)  
-		throw string("negative index !");
-	//index greater than size
-	else if(index >= _size)
-		throw string("index larger than vector size !");
-
-	//if index with the range
-	return buffer[index];
-}
-
-//check where vector obj empty or not 
-inline bool Vector:: empty() const 
-{
-   	return _size == 0;
-}
-
-/*
-It informs the vector of a planned change in size. 
-This enables the vector to manage the storage allocation accordingly. 
-reserve does not change the size of the vector and reallocation happens 
-if and only if the current capacity is less than the argument of reserve
-*/
-void Vector::reserve(unsigned int capacity) 
-{
-    int * newBuffer = new int[capacity];
-
-    for (unsigned int i = 0; i < _size; i++)
-        newBuffer[i] = buffer[i];
-
-    _capacity = capacity;
-    delete[] buffer;
-    buffer = newBuffer;
-}
-
-/*
-It informs the vector of a planned change in size. 
-*/
-void Vector::resize(unsigned int size) 
-{
-    factor = ceil(log((double) size) / log(2.0));
-    reserve(1 << factor);
-    _size = size;
+	return NULL;
 }
 
-/*
-cleared the content vector object 
-*/
-inline void Vector::clear() 
+//accumulate value of concurrent vector element, used by for_each in test case 3
+long long vector_sum = 0;
+void sum_of(int& value)
 {
-    _capacity = 0;
-    _size = 0;
-    buffer = NULL;
-    factor = 0;
+	vector_sum += value;
 }
 
-/*
-vector destructor automatically called when object will go out of scope
-it will delete memory reserved by object
-*/
-inline Vector::~Vector() 
+//element transform used by test case 4
+int square_mod_10(int value)
 {
-    delete[] buffer;
+	return (value % 10) * (value % 10);
 }
 
-
-
-
 int main()
 {
 	
@@ -269,10 +73,11 @@ int main()
 	vector_test_case_1.push_back(500);
 	vector_test_case_1.push_back(600);
 	
-	//exception will raised if try to access invalid index
+	//exception will raised if try to access invalid index through at()
 	try
 	{
-		vector_test_case_1[3] = 900;
+		vector_test_case_1.at(3) = 900;
+		vector_test_case_1.at(10) = 900;
 	}
 	catch(string& e)
 	{
@@ -357,6 +162,210 @@ int main()
         cout<<vector_test_case_2[i]<<" ";
 
 
+	/*
+	Test Case 3 : Create concurrent vector, push back values from 4 threads at the same time
+	then check no value is lost and every thread's values are present
+	*/
+
+	cout<<"\n\n<<---------- Test Case : 3 ---------->>";
+
+	ConcurrentVector vector_test_case_3;
+	pthread_t appender_thread_id[4];
+
+	for(int i=0;i<4;++i)
+		pthread_create(&appender_thread_id[i],NULL,appender_thread,(void*)&vector_test_case_3);
+
+	for(int i=0;i<4;++i)
+		pthread_join(appender_thread_id[i],NULL);
+
+	vector_test_case_3.for_each(sum_of);
+
+	cout<<"\n\nSize of the vector : "<<vector_test_case_3.size();
+	cout<<"\n\nCapacity of the vector : "<<vector_test_case_3.capacity();
+	cout<<"\n\nSum of vector : "<<vector_sum<<" expected : "<<4LL * 10000 * 9999 / 2;
+
+
+	/*
+	Test Case 4 : Create vector of 1000000 random values then sort it with parallel radix
+	and merge sort, compute prefix sum, transform and reduce on all cores
+	*/
+
+	cout<<"\n\n<<---------- Test Case : 4 ---------->>";
+
+	srand(time(NULL));
+	Vector vector_test_case_4(1000000);
+	for(unsigned int i=0;i < vector_test_case_4.size();++i)
+		vector_test_case_4[i] = rand() - RAND_MAX / 2;
+
+	Vector sorted_copy(vector_test_case_4.size());
+	copy(vector_test_case_4.begin(),vector_test_case_4.end(),sorted_copy.begin());
+
+	parallel_radix_sort(vector_test_case_4.begin(),vector_test_case_4.end());
+	parallel_merge_sort(sorted_copy.begin(),sorted_copy.end());
+
+	cout<<"\n\nRadix sorted : "<<is_sorted(vector_test_case_4.begin(),vector_test_case_4.end());
+	cout<<"\n\nMerge sort matches radix sort : "
+	    <<equal(sorted_copy.begin(),sorted_copy.end(),vector_test_case_4.begin());
+
+	//square every element modulo 10 (keeps the prefix sum within int), then prefix sum and total
+	parallel_transform(vector_test_case_4.begin(),vector_test_case_4.end(),vector_test_case_4.begin(),square_mod_10);
+
+	long long total = parallel_reduce(vector_test_case_4.begin(),vector_test_case_4.end(),0LL);
+	parallel_inclusive_scan(vector_test_case_4.begin(),vector_test_case_4.end(),vector_test_case_4.begin());
+
+	cout<<"\n\nSum of vector : "<<total;
+	cout<<"\n\nLast prefix sum : "<<vector_test_case_4.back();
+
+
+	/*
+	Test Case 5 : Create structure of arrays vector of (id, price, quantity) records,
+	push back rows then scan the price and quantity columns on their own
+	*/
+
+	cout<<"\n\n<<---------- Test Case : 5 ---------->>";
+
+	SoAVector<int, double, int> vector_test_case_5;
+
+	for(int i=0;i<10;++i)
+		vector_test_case_5.push_back(i + 1, 2.5 * i, i % 3);
+
+	double total_price = 0;
+	for(double *price = vector_test_case_5.begin<1>();price != vector_test_case_5.end<1>();++price)
+		total_price += *price;
+
+	long long total_quantity = parallel_reduce(vector_test_case_5.begin<2>(),vector_test_case_5.end<2>(),0LL);
+
+	cout<<"\n\nSize of the vector : "<<vector_test_case_5.size();
+	cout<<"\n\nCapacity of the vector : "<<vector_test_case_5.capacity();
+	cout<<"\n\nSum of price column : "<<total_price;
+	cout<<"\n\nSum of quantity column : "<<total_quantity;
+	cout<<"\n\nLast row : "<<get<0>(vector_test_case_5[9])<<" "
+	    <<get<1>(vector_test_case_5[9])<<" "<<get<2>(vector_test_case_5[9]);
+
+
+	/*
+	Test Case 6 : Create vector of 100000 sorted ids and small counters, pack them into
+	compressed vector and compare memory usage and content with the source vector
+	*/
+
+	cout<<"\n\n<<---------- Test Case : 6 ---------->>";
+
+	Vector sorted_ids, counters;
+	int id = 1000000;
+	for(int i=0;i<100000;++i)
+	{
+		id += 1 + rand() % 20;
+		sorted_ids.push_back(id);
+		counters.push_back(rand() % 50);
+	}
+
+	PackedVector packed_ids(sorted_ids), packed_counters(counters);
+
+	bool same = true;
+	for(unsigned int i=0;i < sorted_ids.size();++i)
+		same = same && packed_ids[i] == sorted_ids[i] && packed_counters[i] == counters[i];
+
+	cout<<"\n\nSorted ids : "<<sorted_ids.size() * sizeof(int)<<" bytes, packed : "<<packed_ids.bytes()<<" bytes";
+	cout<<"\n\nCounters : "<<counters.size() * sizeof(int)<<" bytes, packed : "<<packed_counters.bytes()<<" bytes";
+	cout<<"\n\nPacked content matches vector : "<<same;
+
+	/*
+	Test Case 7 : Write 100000 random values (some negative) to a text file, one or a few
+	per line, then bulk load the file into a vector in parallel and compare with the values
+	*/
+
+	cout<<"\n\n<<---------- Test Case : 7 ---------->>";
+
+	Vector written;
+	char path[] = "/tmp/vector_loader_XXXXXX";
+	int fd = mkstemp(path);
+	FILE *file = fdopen(fd, "w");
+	for(int i=0;i<100000;++i)
+	{
+		written.push_back(rand() - RAND_MAX / 2);
+		fprintf(file, "%d%c", written.back(), i % 3 == 0 ? ' ' : '\n');
+	}
+	fclose(file);
+
+	ThreadPool loader_pool(4);
+	Vector loaded;
+	unsigned int count = load_vector(path, loaded, loader_pool);
+	remove(path);
+
+	same = count == written.size() && loaded.size() == written.size();
+	for(unsigned int i=0;same && i < written.size();++i)
+		same = loaded[i] == written[i];
+
+	cout<<"\n\nLoaded "<<count<<" values, first : "<<loaded.front()<<", last : "<<loaded.back();
+	cout<<"\n\nLoaded content matches written values : "<<same;
+
+	/*
+	Test Case 8 : Create vector of 4000000 values spread over the NUMA nodes, grow it with
+	interleaved pages, refill it bound to node 0 and print on which NUMA node its pages are
+	*/
+
+	cout<<"\n\n<<---------- Test Case : 8 ---------->>";
+
+	Vector placed;
+	numa_resize(placed, 4000000, 7, NUMA_SPREAD, 0, loader_pool);
+	same = placed.size() == 4000000 && placed.front() == 7 && placed.back() == 7;
+
+	numa_resize(placed, 6000000, 9, NUMA_INTERLEAVE, 0, loader_pool);
+	same = same && placed.size() == 6000000 && placed[3999999] == 7 && placed[4000000] == 9;
+
+	numa_fill(placed, 5, NUMA_BIND, 0, loader_pool);
+	for(unsigned int i=0;same && i < placed.size();++i)
+		same = placed[i] == 5;
+
+	vector<unsigned long> pages = numa_page_nodes(placed);
+	cout<<"\n\n"<<numa_node_count()<<" NUMA node(s), pages per node :";
+	for(unsigned int i=0;i + 1 < pages.size();++i)
+		cout<<" "<<pages[i];
+	if(pages.empty())
+		cout<<" unknown";
+	cout<<"\n\nPlaced content matches values : "<<same;
+
+	/*
+	Test Case 9 : Create sorted vector of 1000000 values with duplicates, build a search
+	index from it and compare its lower bounds, one by one and batched, with binary search
+	*/
+
+	cout<<"\n\n<<---------- Test Case : 9 ---------->>";
+
+	Vector keys;
+	for(int i=0;i<1000000;++i)
+		keys.push_back(rand() % 4000000 - 2000000);
+	parallel_radix_sort(keys.begin(), keys.end(), loader_pool);
+	SortedIndex index(keys);
+
+	Vector queries;
+	for(int i=0;i<100000;++i)
+		queries.push_back(rand() % 4200000 - 2100000);
+	queries.push_back(INT_MIN);
+	queries.push_back(INT_MAX);
+	queries.push_back(keys.front());
+	queries.push_back(keys.back());
+
+	vector<unsigned int> positions(queries.size());
+	bool *found = new bool[queries.size()];
+	index.lower_bound(queries.begin(), queries.size(), &positions[0]);
+	index.contains(queries.begin(), queries.size(), found);
+
+	same = true;
+	unsigned int hits = 0;
+	for(unsigned int i=0;same && i < queries.size();++i)
+	{
+		unsigned int expected = std::lower_bound(keys.begin(), keys.end(), queries[i]) - keys.begin();
+		bool present = expected < keys.size() && keys[expected] == queries[i];
+		same = index.lower_bound(queries[i]) == expected && positions[i] == expected
+			&& index.contains(queries[i]) == present && found[i] == present;
+		hits += present;
+	}
+	delete[] found;
+
+	cout<<"\n\nIndex of "<<index.size()<<" values in "<<index.bytes()<<" bytes, "<<hits<<" of "<<queries.size()<<" queries found";
+	cout<<"\n\nIndex lookups match binary search : "<<same;
+
 	cout<<endl;
 	
 	return 0;
@@ -0,0 +1,274 @@
+#ifndef VECTOR_LOADER_H
+#define VECTOR_LOADER_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "vector.h"
+#include "parallel_algorithms.h"
+
+/*
+Bulk loader, fills a Vector with the integers of a text file
+Instead of one parse and one push_back per value the file is memory mapped
+and cut into chunks of about 1 MB whose borders are moved to just behind a
+separator, so no number is split. Two passes run over the chunks in
+parallel on the thread pool:
+
+count pass  - counts the numbers of every chunk, i.e; the starts of digit
+			  runs, with SSE2 16 bytes at a time
+parse pass  - every chunk parses its numbers straight into its own range
+			  of the Vector, which was resized uninitialized to the exact
+			  total once, so every element is written once
+
+Digit runs are found with the same SSE2 compares and up to 8 digits are
+converted at once with SWAR (SIMD within a register) multiplies, longer
+runs take a second step. Numbers are runs of digits, a '-' right in front
+makes them negative, anything else separates them. Values must fit int.
+Without SSE2 or on big endian machines the same passes run in scalar code.
+*/
+
+/*
+return 1 if c is '0' ... '9'
+*/
+static inline bool loader_is_digit(char c)
+{
+    return (unsigned char)(c - '0') < 10;
+}
+
+#if defined(__SSE2__)
+/*
+return 16 bit mask with bit i set if p[i] is a digit
+*/
+static inline unsigned int loader_digit_mask(const char *p)
+{
+    __m128i bytes = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)p), _mm_set1_epi8('0'));
+    //unsigned bytes - '0' <= 9 exactly for digits
+    __m128i digits = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(9)), bytes);
+    return (unsigned int)_mm_movemask_epi8(digits);
+}
+#endif
+
+/*
+return no. of numbers (digit runs) starting in [begin, end), begin
+must follow a non digit
+*/
+static inline unsigned int loader_count(const char *begin, const char *end)
+{
+    unsigned int count = 0;
+    const char *p = begin;
+    bool in_digits = false;
+
+#if defined(__SSE2__)
+    unsigned int carry = 0;
+    for (; p + 16 <= end; p += 16)
+    {
+        unsigned int mask = loader_digit_mask(p);
+        //a run starts at every digit whose left neighbour is no digit
+        count += __builtin_popcount(mask & ~((mask << 1) | carry));
+        carry = mask >> 15;
+    }
+    in_digits = carry;
+#endif
+
+    for (; p < end; ++p)
+    {
+        bool digit = loader_is_digit(*p);
+        count += digit && !in_digits;
+        in_digits = digit;
+    }
+    return count;
+}
+
+/*
+return length of the digit run starting at p, limit is the end of the file
+*/
+static inline unsigned int loader_run_length(const char *p, const char *limit)
+{
+    const char *q = p;
+#if defined(__SSE2__)
+    for (; q + 16 <= limit; q += 16)
+    {
+        unsigned int others = ~loader_digit_mask(q) & 0xFFFF;
+        if (others != 0)
+            return q - p + __builtin_ctz(others);
+    }
+#endif
+    while (q < limit && loader_is_digit(*q))
+        ++q;
+    return q - p;
+}
+
+/*
+return value of the len (1 ... 8) digits at p, limit is the end of the file
+*/
+static inline unsigned int loader_parse_eight(const char *p, unsigned int len, const char *limit)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (p + 8 <= limit)
+    {
+        //first digit in the lowest byte, shifting left right aligns the
+        //digits and fills the low bytes with 0 digits
+        uint64_t chunk;
+        memcpy(&chunk, p, 8);
+        chunk = (chunk << (8 * (8 - len))) & 0x0F0F0F0F0F0F0F0FULL;
+        //combine neighbour digits, then neighbour pairs, then neighbour quads
+        chunk = (chunk * (10 * (1 << 8) + 1)) >> 8;
+        chunk = ((chunk & 0x00FF00FF00FF00FFULL) * (100 * (1 << 16) + 1)) >> 16;
+        chunk = ((chunk & 0x0000FFFF0000FFFFULL) * (10000 * (1ULL << 32) + 1)) >> 32;
+        return (unsigned int)chunk;
+    }
+#endif
+    unsigned int value = 0;
+    for (unsigned int i = 0; i < len; ++i)
+        value = value * 10 + (p[i] - '0');
+    return value;
+}
+
+/*
+return value of the len digits at p, wraps around beyond unsigned int
+*/
+static inline unsigned int loader_parse_digits(const char *p, unsigned int len, const char *limit)
+{
+    if (len <= 8)
+        return loader_parse_eight(p, len, limit);
+
+    //leading digits first, then full groups of 8
+    unsigned int head = len % 8 == 0 ? 8 : len % 8;
+    unsigned int value = loader_parse_eight(p, head, limit);
+    for (unsigned int i = head; i < len; i += 8)
+        value = value * 100000000u + loader_parse_eight(p + i, 8, limit);
+    return value;
+}
+
+/*
+parse every number starting in [begin, end) into out, begin must follow
+a non digit, file is the whole mapped file (for the sign and reads beyond
+the chunk), return no. of numbers parsed
+*/
+static inline unsigned int loader_parse(const char *begin, const char *end, const char *file,
+                                        const char *limit, int *out)
+{
+    int *first = out;
+    const char *p = begin;
+    while (true)
+    {
+        //skip to the next digit
+#if defined(__SSE2__)
+        while (p + 16 <= end)
+        {
+            unsigned int mask = loader_digit_mask(p);
+            if (mask != 0)
+            {
+                p += __builtin_ctz(mask);
+                break;
+            }
+            p += 16;
+        }
+#endif
+        while (p < end && !loader_is_digit(*p))
+            ++p;
+        if (p >= end)
+            break;
+
+        bool negative = p > file && p[-1] == '-';
+        unsigned int len = loader_run_length(p, limit);
+        unsigned int value = loader_parse_digits(p, len, limit);
+        *out++ = (int)(negative ? 0u - value : value);
+        p += len;
+    }
+    return out - first;
+}
+
+/*
+append every integer in the text file at given path to target and return
+no. of integers loaded, raised exception if the file can not be read or
+has more integers than a Vector can hold
+*/
+inline unsigned int load_vector(const char *path, Vector& target, ThreadPool& pool = default_thread_pool())
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        throw std::string("can not open file !");
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        throw std::string("can not read file !");
+    }
+    size_t size = info.st_size;
+    if (size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw std::string("can not map file !");
+    //every chunk is read front to back, start reading ahead now
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    madvise(mapping, size, MADV_WILLNEED);
+
+    const char *file = (const char*)mapping, *limit = file + size;
+
+    //chunk borders, each moved forward to just behind a separator that
+    //is not a '-', so no digit run or its sign is split
+    size_t chunks = parallel_block_count(size, 1 << 20, pool);
+    std::vector<size_t> border(chunks + 1);
+    border[0] = 0;
+    border[chunks] = size;
+    for (size_t c = 1; c < chunks; ++c)
+    {
+        size_t b = size * c / chunks;
+        if (b < border[c - 1])
+            b = border[c - 1];
+        while (b < size && (loader_is_digit(file[b - 1]) || file[b - 1] == '-'))
+            ++b;
+        border[c] = b;
+    }
+
+    //count pass, then offsets of every chunk in the Vector
+    std::vector<unsigned int> counts(chunks);
+    parallel_for(0, chunks, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c)
+            counts[c] = loader_count(file + border[c], file + border[c + 1]);
+    }, pool);
+
+    unsigned long long total = 0;
+    std::vector<unsigned int> offsets(chunks);
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        offsets[c] = (unsigned int)total;
+        total += counts[c];
+    }
+    if (target.size() + total > (1u << 31))
+    {
+        munmap(mapping, size);
+        throw std::string("file has more values than a vector can hold !");
+    }
+
+    unsigned int base = target.size();
+    target.resize_uninitialized(base + (unsigned int)total);
+    int *out = target.begin() + base;
+
+    //parse pass, every chunk writes its own range
+    parallel_for(0, chunks, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c)
+            loader_parse(file + border[c], file + border[c + 1], file, limit, out + offsets[c]);
+    }, pool);
+
+    munmap(mapping, size);
+    return (unsigned int)total;
+}
+
+#endif
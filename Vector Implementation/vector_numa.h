@@ -0,0 +1,311 @@
+#ifndef VECTOR_NUMA_H
+#define VECTOR_NUMA_H
+
+#include <cstdio>
+#include <vector>
+#include <stdint.h>
+#include <string>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "vector.h"
+#include "parallel_algorithms.h"
+
+/*
+NUMA placement of large Vectors
+Linux puts a page on the NUMA node of the thread that first writes it.
+Vector(size, value) writes every element from the constructing thread,
+so all pages land on that thread's node and workers on the other sockets
+read remote memory for the whole run. The functions here construct,
+resize and fill a Vector with one of three placements:
+
+NUMA_SPREAD      - the elements are cut into the same blocks (n * b / blocks)
+				   the multi pass parallel algorithms (reduce, scan, radix
+				   sort) use and the blocks are spread over the nodes in
+				   order, block b preferring node b * nodes / blocks, so
+				   every node holds an equal, contiguous share
+NUMA_INTERLEAVE  - pages are spread round robin over all nodes, the choice
+				   for data every thread reads all of
+NUMA_BIND        - every page goes to the given node
+
+Placement is set explicitly with mbind() on the whole pages of the elements
+before they are written, and moves pages written before. Leaving it to first
+touch would place a block on whatever node the worker that happened to steal
+it runs on, pool workers are not pinned. Placement is a hint, on kernels or
+machines without NUMA it fails silently and elements are written all the same.
+numa_page_nodes() reports where the pages actually are, via move_pages().
+
+A buffer that has to grow is mapped fresh with mmap() and adopted by the
+Vector (Vector::adopt), new int[] may hand out recycled pages some thread
+already wrote, and those stay on their node whatever policy is set later.
+
+Construct a placed Vector with Vector v; numa_resize(v, size, value, ...)
+The syscalls are called directly, no libnuma is needed.
+Compile the program that includes this header with -lpthread
+*/
+
+enum NumaPolicy
+{
+    NUMA_SPREAD,
+    NUMA_INTERLEAVE,
+    NUMA_BIND
+};
+
+//memory policy modes and flags of mbind(2), as in <numaif.h>
+static const int NUMA_MPOL_DEFAULT = 0;
+static const int NUMA_MPOL_PREFERRED = 1;
+static const int NUMA_MPOL_BIND = 2;
+static const int NUMA_MPOL_INTERLEAVE = 3;
+static const unsigned int NUMA_MPOL_MF_MOVE = 1 << 1;
+
+/*
+read no. of possible NUMA nodes from sysfs, 1 if there is no NUMA
+*/
+inline int numa_read_node_count()
+{
+    //list like "0" or "0-3", the last no. is the highest node
+    FILE *file = fopen("/sys/devices/system/node/possible", "r");
+    int highest = 0, value;
+    char separator;
+    if (file != NULL)
+    {
+        while (fscanf(file, "%d%c", &value, &separator) >= 1)
+            highest = value > highest ? value : highest;
+        fclose(file);
+    }
+    return highest + 1;
+}
+
+/*
+return no. of possible NUMA nodes, read once, the static is initialized
+thread safe so pool workers may call it concurrently
+*/
+inline int numa_node_count()
+{
+    static const int nodes = numa_read_node_count();
+    return nodes;
+}
+
+/*
+shrink [addr, addr + bytes) to the whole pages inside it, return false if
+there is none. Pages partly outside may hold other allocations, so they
+are left alone
+*/
+inline bool numa_whole_pages(const void *addr, size_t bytes, uintptr_t& first, uintptr_t& last)
+{
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    first = ((uintptr_t)addr + page - 1) & ~(page - 1);
+    last = ((uintptr_t)addr + bytes) & ~(page - 1);
+    return first < last;
+}
+
+/*
+set memory policy mode on the whole pages of [addr, addr + bytes) and move
+pages already written. node is the node of preferred and bind, -1 for every
+node (interleave), ignored for default.
+return false if the kernel refused, e.g; no NUMA support
+*/
+inline bool numa_mbind(void *addr, size_t bytes, int mode, int node)
+{
+    uintptr_t first, last;
+    if (!numa_whole_pages(addr, bytes, first, last))
+        return true;
+
+    int nodes = numa_node_count();
+    if (node >= nodes)
+        return false;
+    std::vector<unsigned long> mask(nodes / (8 * sizeof(unsigned long)) + 1, 0);
+    for (int n = 0; n < nodes; ++n)
+        if (node < 0 || n == node)
+            mask[n / (8 * sizeof(unsigned long))] |= 1ul << (n % (8 * sizeof(unsigned long)));
+
+    //the kernel reads maxnode - 1 bits of the mask
+    unsigned long maxnode = mask.size() * 8 * sizeof(unsigned long) + 1;
+    return syscall(SYS_mbind, first, last - first, mode,
+                   mode == NUMA_MPOL_DEFAULT ? NULL : &mask[0], maxnode,
+                   mode == NUMA_MPOL_DEFAULT ? 0 : NUMA_MPOL_MF_MOVE) == 0;
+}
+
+/*
+apply interleave or bind to the whole pages of [addr, addr + bytes), pages
+already written are moved. Spread resets the range to the default policy,
+use numa_spread for it as it needs the block split.
+return false if the kernel refused, e.g; no NUMA support
+*/
+inline bool numa_set_policy(void *addr, size_t bytes, NumaPolicy policy, int node = 0)
+{
+    if (policy == NUMA_INTERLEAVE)
+        return numa_mbind(addr, bytes, NUMA_MPOL_INTERLEAVE, -1);
+    if (policy == NUMA_BIND)
+        return node >= 0 && numa_mbind(addr, bytes, NUMA_MPOL_BIND, node);
+    return numa_mbind(addr, bytes, NUMA_MPOL_DEFAULT, 0);
+}
+
+/*
+place n elements from data block by block, block b of the split
+numa_parallel_blocks uses preferring node b * nodes / blocks. Preferred
+and not bound, so a full node spills over instead of failing.
+return false if the kernel refused, e.g; no NUMA support
+*/
+inline bool numa_spread(int *data, size_t n, ThreadPool& pool)
+{
+    int nodes = numa_node_count();
+    if (nodes == 1)
+        return true;
+    size_t blocks = parallel_block_count(n, PARALLEL_GRAIN, pool);
+    bool placed = true;
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        size_t from = n * b / blocks, to = n * (b + 1) / blocks;
+        placed = numa_mbind(data + from, (to - from) * sizeof(int), NUMA_MPOL_PREFERRED,
+                            (int)(b * nodes / blocks)) && placed;
+    }
+    return placed;
+}
+
+/*
+place n elements from data with given policy, see numa_set_policy / numa_spread
+*/
+inline bool numa_place(int *data, size_t n, NumaPolicy policy, int node, ThreadPool& pool)
+{
+    if (policy == NUMA_SPREAD)
+        return numa_spread(data, n, pool);
+    return numa_set_policy(data, n * sizeof(int), policy, node);
+}
+
+/*
+map capacity ints of fresh anonymous memory, no page is written (or placed)
+until the first touch, raised exception if the mapping fails
+*/
+inline int* numa_map(unsigned int capacity)
+{
+    void *storage = mmap(NULL, (size_t)capacity * sizeof(int), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (storage == MAP_FAILED)
+        throw std::string("memory can not be mapped !");
+    return (int*)storage;
+}
+
+/*
+unmap storage of numa_map, release function of Vectors adopting it
+*/
+inline void numa_unmap(int *storage, unsigned int capacity)
+{
+    munmap(storage, (size_t)capacity * sizeof(int));
+}
+
+/*
+call body(from, to) on the blocks of [0, n) in parallel, the same blocks
+parallel_reduce / parallel_scan / parallel_radix_sort split n elements into
+*/
+template <typename Body>
+inline void numa_parallel_blocks(size_t n, const Body& body, ThreadPool& pool)
+{
+    size_t blocks = parallel_block_count(n, PARALLEL_GRAIN, pool);
+    parallel_for(0, blocks, 1, [n, blocks, &body](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; ++b)
+            body(n * b / blocks, n * (b + 1) / blocks);
+    }, pool);
+}
+
+/*
+resize target to size, elements added by growing the size are set to value.
+If the capacity has to grow the new buffer is placed before any element is
+written, then kept elements are copied and new ones filled in parallel
+*/
+inline void numa_resize(Vector& target, unsigned int size, int value, NumaPolicy policy, int node = 0,
+                        ThreadPool& pool = default_thread_pool())
+{
+    unsigned int old_size = target.size();
+
+    if (size <= target.capacity())
+    {
+        //grown part of the capacity may be placed still
+        target.resize_uninitialized(size);
+        if (size <= old_size)
+            return;
+        numa_place(target.begin() + old_size, size - old_size, policy, node, pool);
+        int *out = target.begin() + old_size;
+        numa_parallel_blocks(size - old_size, [out, value](size_t from, size_t to) {
+            for (size_t i = from; i < to; ++i)
+                out[i] = value;
+        }, pool);
+        return;
+    }
+
+    //freshly mapped, so no page of grown is written or placed yet
+    Vector grown;
+    unsigned int capacity = 1u << growth_factor(size);
+    grown.adopt(numa_map(capacity), capacity, numa_unmap);
+    grown.resize_uninitialized(size);
+    numa_place(grown.begin(), size, policy, node, pool);
+
+    const int *in = target.begin();
+    int *out = grown.begin();
+    numa_parallel_blocks(size, [in, out, old_size, value](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i)
+            out[i] = i < old_size ? in[i] : value;
+    }, pool);
+    target.swap(grown);
+}
+
+/*
+set every element of target to value in parallel, pages written before
+are moved to their nodes first
+*/
+inline void numa_fill(Vector& target, int value, NumaPolicy policy, int node = 0,
+                      ThreadPool& pool = default_thread_pool())
+{
+    numa_place(target.begin(), target.size(), policy, node, pool);
+    int *out = target.begin();
+    numa_parallel_blocks(target.size(), [out, value](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i)
+            out[i] = value;
+    }, pool);
+}
+
+/*
+return no. of pages of [addr, addr + bytes) on every node, one entry per
+node and a last entry for pages not placed yet (never written). Return an
+empty vector if the kernel can not tell, e.g; no NUMA support
+*/
+inline std::vector<unsigned long> numa_page_nodes(const void *addr, size_t bytes)
+{
+    std::vector<unsigned long> pages(numa_node_count() + 1, 0);
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t first = (uintptr_t)addr & ~(page - 1), last = (uintptr_t)addr + bytes;
+    if (bytes == 0)
+        return pages;
+
+    //query a batch of pages at a time, no node list means only report
+    const size_t BATCH = 4096;
+    std::vector<void*> batch(BATCH);
+    std::vector<int> status(BATCH);
+    for (uintptr_t p = first; p < last; )
+    {
+        size_t count = 0;
+        for (; count < BATCH && p < last; ++count, p += page)
+            batch[count] = (void*)p;
+        if (syscall(SYS_move_pages, 0, count, &batch[0], NULL, &status[0], 0) != 0)
+            return std::vector<unsigned long>();
+        for (size_t i = 0; i < count; ++i)
+        {
+            //negative status is an error no., -ENOENT for pages not present
+            if (status[i] >= 0 && status[i] < (int)pages.size() - 1)
+                pages[status[i]]++;
+            else
+                pages.back()++;
+        }
+    }
+    return pages;
+}
+
+/*
+return no. of pages of the elements of v on every node, see above
+*/
+inline std::vector<unsigned long> numa_page_nodes(Vector& v)
+{
+    return numa_page_nodes(v.begin(), v.size() * sizeof(int));
+}
+
+#endif